@@ -1,9 +1,43 @@
 /* Author Ricardo Fabbri rfabbri@iprj.uerj.br 2025 */
 #include <benchmark/benchmark.h>
 #include <sorted_merge_3way.h>
+#include <sorted_merge_kway.h>
+#include <merge_dispatch.h>
+#include <sorted_merge_files.h>
+#include <sorted_merge.hpp>
+#include <merge_cursor.h>
+#include <sorted_merge_set.h>
+#include <merge_sort.h>
+#include <sorted_merge_batch.h>
+#include <sorted_merge_inplace.h>
+#include <sorted_merge_varint.h>
+#include <merge_stats.h>
+#include <merge_async.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 #include <vector>
 #include <algorithm>
 #include <random>
+#include <string>
+#include <tuple>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <time.h>
 
 // Fills a vector with sorted random integers.
 static void fill_sorted_list(std::vector<int>& list, int size) {
@@ -34,9 +68,342 @@ public:
   std::vector<int> list_abc;
 };
 
+// range(1) selects the kernel (see merge_dispatch.h); compare rows of the
+// same size to read the speedup over the reference branchy kernel.
 BENCHMARK_DEFINE_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)(benchmark::State& state) {
+  if (!merge_set_kernel((merge_kernel) state.range(1))) {
+    state.SkipWithError("kernel not supported on this CPU");
+    return;
+  }
+  for (auto _ : state) {
+    sorted_merge_3way64(list_a.data(), list_a.size(),
+                 list_b.data(), list_b.size(),
+                 list_c.data(), list_c.size(),
+                 list_abc.data());
+  }
+  state.SetItemsProcessed(state.iterations() * 3 * state.range(0));
+  merge_set_kernel(MERGE_KERNEL_AUTO);
+}
+
+static void
+merge_3way_args(benchmark::internal::Benchmark *b)
+{
+  static const int sizes[] = {
+    0, 1, 2, 10, 50, 100, 500, 1000, 10000, 100000, 1000000, 10000000 };
+  b->ArgNames({"n", "kernel"});
+  for (int n : sizes)
+    for (int k = MERGE_KERNEL_BRANCHY; k <= MERGE_KERNEL_AVX2; ++k)
+      b->Args({n, k});
+}
+
+BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Apply(merge_3way_args);
+
+// Three lists of 10^6 built from runs of range(0) consecutive values, each run
+// sent to a random list: 1 is fully interleaved, 64 lightly overlapping and
+// 3000000 disjoint. range(1) is the kernel; compare MERGE_KERNEL_GALLOP with
+// the others.
+class sorted_merge_runs_fixture : public benchmark::Fixture {
+public:
+  void SetUp(const ::benchmark::State& state) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> pick(0, 2);
+    int total = 3000000, run = state.range(0);
+    for (int i = 0; i < 3; ++i)
+      lists[i].clear();
+    for (int v = 0; v < total; v += run) {
+      std::vector<int> &l = run >= total ? lists[0] : lists[pick(gen)];
+      for (int j = v; j < v + run && j < total; ++j)
+        l.push_back(j);
+    }
+    if (run >= total) {
+      // disjoint: a third of the range per list
+      lists[2].assign(lists[0].begin() + 2 * total / 3, lists[0].end());
+      lists[1].assign(lists[0].begin() + total / 3, lists[0].begin() + 2 * total / 3);
+      lists[0].resize(total / 3);
+    }
+    list_abc.resize(total);
+  }
+
+  std::vector<int> lists[3];
+  std::vector<int> list_abc;
+};
+
+BENCHMARK_DEFINE_F(sorted_merge_runs_fixture, BM_sorted_merge_3way_runs)(benchmark::State& state) {
+  if (!merge_set_kernel((merge_kernel) state.range(1))) {
+    state.SkipWithError("kernel not supported on this CPU");
+    return;
+  }
+  for (auto _ : state) {
+    sorted_merge_3way_trusted(lists[0].data(), lists[0].size(),
+                 lists[1].data(), lists[1].size(),
+                 lists[2].data(), lists[2].size(),
+                 list_abc.data());
+  }
+  state.SetItemsProcessed(state.iterations() * list_abc.size());
+  merge_set_kernel(MERGE_KERNEL_AUTO);
+}
+
+BENCHMARK_REGISTER_F(sorted_merge_runs_fixture, BM_sorted_merge_3way_runs)
+  ->ArgNames({"run", "kernel"})
+  ->ArgsProduct({{1, 8, 64, 1024, 3000000},
+                 {MERGE_KERNEL_BRANCHLESS, MERGE_KERNEL_AVX2, MERGE_KERNEL_GALLOP}});
+
+// Input matrix for sorted_merge_3way_trusted(). range(0) is the total input size,
+// range(1) the value distribution and range(2) the length ratio: list_a gets
+// `ratio` times as many elements as list_b and list_c. range(3) is the kernel.
+enum merge_dist {
+  DIST_UNIFORM,    // random over the whole int range, few duplicates
+  DIST_DUPS,       // 16 distinct values, long runs of equal keys
+  DIST_DISJOINT,   // a < b < c, as if one sorted array had been cut in three
+  DIST_ONE_EMPTY,  // list_c empty, uniform otherwise
+  DIST_TWO_EMPTY   // list_b and list_c empty
+};
+
+struct merge_inputs {
+  std::vector<int> lists[3];
+};
+
+// Inputs are generated once per (n, dist, ratio) with their own seed and then
+// shared, so repetitions and the kernel sweep do not pay for generation. Only
+// the latest set is kept: the sweeps are registered innermost, and keeping
+// every set would hold gigabytes of inputs through the rest of the run.
+static const merge_inputs &
+cached_inputs(size_t n, int dist, int ratio)
+{
+  static merge_inputs in;
+  static std::tuple<size_t, int, int> cached_key(SIZE_MAX, 0, 0);
+  auto key = std::make_tuple(n, dist, ratio);
+  if (key == cached_key)
+    return in;
+
+  // release the previous set before generating the next
+  in = merge_inputs();
+  cached_key = key;
+  size_t len[3];
+  len[1] = len[2] = n / (ratio + 2);
+  len[0] = n - 2 * len[1];
+  if (dist == DIST_ONE_EMPTY) {
+    len[0] += len[2];
+    len[2] = 0;
+  } else if (dist == DIST_TWO_EMPTY) {
+    len[0] = n;
+    len[1] = len[2] = 0;
+  }
+
+  std::mt19937 gen(n * 31 + dist * 7 + ratio);
+  std::uniform_int_distribution<int> uniform(INT32_MIN, INT32_MAX);
+  std::uniform_int_distribution<int> dups(0, 15);
+  int base = 0;
+  for (int i = 0; i < 3; ++i) {
+    std::vector<int> &l = in.lists[i];
+    l.resize(len[i]);
+    if (dist == DIST_DISJOINT) {
+      for (size_t j = 0; j < len[i]; ++j)
+        l[j] = base + j;
+      base += len[i];
+      continue;
+    }
+    for (int &v : l)
+      v = dist == DIST_DUPS ? dups(gen) : uniform(gen);
+    std::sort(l.begin(), l.end());
+  }
+  return in;
+}
+
+class sorted_merge_matrix_fixture : public benchmark::Fixture {
+public:
+  void SetUp(const ::benchmark::State& state) {
+    in = &cached_inputs(state.range(0), state.range(1), state.range(2));
+    list_abc.resize(state.range(0));
+  }
+
+  const merge_inputs *in;
+  std::vector<int> list_abc;
+};
+
+// Hardware counters of the calling thread through perf_event_open(2), user
+// space only. Events the CPU, the VM or perf_event_paranoid do not allow are
+// left out, so on machines without a PMU nothing is reported.
+#ifdef __linux__
+struct perf_event_spec {
+  const char *name;
+  uint32_t type;
+  uint64_t config;
+};
+
+static const perf_event_spec perf_events[] = {
+  { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+  { "llc_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+      PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+};
+#define N_PERF_EVENTS (sizeof(perf_events) / sizeof(perf_events[0]))
+
+class perf_counters {
+public:
+  perf_counters() {
+    for (size_t i = 0; i < N_PERF_EVENTS; ++i) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = perf_events[i].type;
+      attr.config = perf_events[i].config;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+  }
+  ~perf_counters() {
+    for (int f : fd)
+      if (f >= 0)
+        close(f);
+  }
+  void start() {
+    for (int f : fd)
+      if (f >= 0) {
+        ioctl(f, PERF_EVENT_IOC_RESET, 0);
+        ioctl(f, PERF_EVENT_IOC_ENABLE, 0);
+      }
+  }
+  // Stops counting and adds each event per item, and the IPC, to state.
+  void report(benchmark::State& state, double items) {
+    uint64_t v[N_PERF_EVENTS];
+    bool ok[N_PERF_EVENTS];
+    for (size_t i = 0; i < N_PERF_EVENTS; ++i) {
+      ok[i] = fd[i] >= 0 && !ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0) &&
+          read(fd[i], &v[i], sizeof(v[i])) == sizeof(v[i]);
+      if (ok[i] && items > 0)
+        state.counters[std::string(perf_events[i].name) + "_per_item"] =
+            v[i] / items;
+    }
+    if (ok[0] && ok[1] && v[0])
+      state.counters["ipc"] = (double) v[1] / v[0];
+  }
+
+private:
+  int fd[N_PERF_EVENTS];
+};
+#else
+class perf_counters {
+public:
+  void start() {}
+  void report(benchmark::State&, double) {}
+};
+#endif
+
+// With an instrumented libmerge, the comparisons per output and the mean run
+// length (outputs per run) of everything merged since merge_stats_reset().
+static void
+report_merge_stats(benchmark::State& state)
+{
+  merge_stats st;
+  if (!merge_stats_enabled())
+    return;
+  merge_stats_get(&st);
+  uint64_t outputs = st.outputs[0] + st.outputs[1] + st.outputs[2];
+  if (!outputs || !st.runs)
+    return;
+  state.counters["cmp_per_item"] = (double) st.comparisons / outputs;
+  state.counters["mean_run"] = (double) outputs / st.runs;
+}
+
+// Bytes counts every input read and output write, 8 bytes per element.
+BENCHMARK_DEFINE_F(sorted_merge_matrix_fixture, BM_sorted_merge_3way_matrix)(benchmark::State& state) {
+  if (!merge_set_kernel((merge_kernel) state.range(3))) {
+    state.SkipWithError("kernel not supported on this CPU");
+    return;
+  }
+  const std::vector<int> *l = in->lists;
+  perf_counters perf;
+  merge_stats_reset();
+  perf.start();
+  for (auto _ : state) {
+    sorted_merge_3way_trusted(l[0].data(), l[0].size(),
+                 l[1].data(), l[1].size(),
+                 l[2].data(), l[2].size(),
+                 list_abc.data());
+    benchmark::ClobberMemory();
+  }
+  perf.report(state, (double) state.iterations() * list_abc.size());
+  report_merge_stats(state);
+  state.SetItemsProcessed(state.iterations() * list_abc.size());
+  state.SetBytesProcessed(state.iterations() * list_abc.size() * 2 * sizeof(int));
+  merge_set_kernel(MERGE_KERNEL_AUTO);
+}
+
+// Sizes from L1-resident (12 KB of input) to well past the last-level cache
+// (3 * 2^24 ints, 192 MB in and 192 MB out). Ratios only apply where all three
+// lists are populated.
+static void
+merge_matrix_args(benchmark::internal::Benchmark *b)
+{
+  static const int sizes[] = { 3 << 10, 3 << 16, 3 << 20, 3 << 24 };
+  static const int kernels[] = { MERGE_KERNEL_AUTO, MERGE_KERNEL_GALLOP };
+  b->ArgNames({"n", "dist", "ratio", "kernel"});
+  for (int n : sizes)
+    for (int d = DIST_UNIFORM; d <= DIST_TWO_EMPTY; ++d)
+      for (int ratio : { 1, 16, 1024 }) {
+        if (d >= DIST_ONE_EMPTY && ratio != 1)
+          continue;
+        for (int k : kernels)
+          b->Args({n, d, ratio, k});
+      }
+}
+
+BENCHMARK_REGISTER_F(sorted_merge_matrix_fixture, BM_sorted_merge_3way_matrix)
+  ->Apply(merge_matrix_args);
+
+// Outputs of 16 MB to 1 GB from uniform lists, where the merge is bound by
+// compute, and from disjoint lists, where it is bound by memory. range(3) = 1
+// forces the non-temporal store mode and 0 turns it off. Bytes count the read
+// and the write of every element.
+BENCHMARK_DEFINE_F(sorted_merge_matrix_fixture, BM_sorted_merge_3way_stream)(benchmark::State& state) {
+  size_t saved = merge_get_stream_threshold();
+  merge_set_stream_threshold(state.range(3) ? 0 : MERGE_STREAM_OFF);
+  const std::vector<int> *l = in->lists;
+  for (auto _ : state) {
+    sorted_merge_3way_trusted(l[0].data(), l[0].size(),
+                 l[1].data(), l[1].size(),
+                 l[2].data(), l[2].size(),
+                 list_abc.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * list_abc.size());
+  state.SetBytesProcessed(state.iterations() * list_abc.size() * 2 * sizeof(int));
+  merge_set_stream_threshold(saved);
+}
+
+static void
+merge_stream_args(benchmark::internal::Benchmark *b)
+{
+  b->ArgNames({"n", "dist", "ratio", "stream"});
+  for (int d : { DIST_UNIFORM, DIST_DISJOINT })
+    for (int mb : { 16, 64, 256, 1024 })
+      for (int s : { 0, 1 })
+        b->Args({mb << 18, d, 1, s});
+}
+
+BENCHMARK_REGISTER_F(sorted_merge_matrix_fixture, BM_sorted_merge_3way_stream)
+  ->Apply(merge_stream_args)
+  ->Unit(benchmark::kMillisecond);
+
+// Validation strategies: two passes (sorted_merge_3way above with the same
+// kernel), checks fused into the branchless merge, and no check at all.
+BENCHMARK_DEFINE_F(sorted_merge_3way_fixture, BM_sorted_merge_3way_fused)(benchmark::State& state) {
+  for (auto _ : state) {
+    sorted_merge_3way_fused(list_a.data(), list_a.size(),
+                 list_b.data(), list_b.size(),
+                 list_c.data(), list_c.size(),
+                 list_abc.data());
+  }
+  state.SetItemsProcessed(state.iterations() * 3 * state.range(0));
+}
+
+BENCHMARK_DEFINE_F(sorted_merge_3way_fixture, BM_sorted_merge_3way_trusted)(benchmark::State& state) {
   for (auto _ : state) {
-    sorted_merge_3way(list_a.data(), list_a.size(),
+    sorted_merge_3way_trusted(list_a.data(), list_a.size(),
                  list_b.data(), list_b.size(),
                  list_c.data(), list_c.size(),
                  list_abc.data());
@@ -44,16 +411,680 @@ BENCHMARK_DEFINE_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)(benchmark::S
   state.SetItemsProcessed(state.iterations() * 3 * state.range(0));
 }
 
-BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Arg(0);
-BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Arg(1);
-BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Arg(2);
-BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Arg(10);
-BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Arg(50);
-BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Arg(100);
-BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Arg(500);
-BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Arg(1000);
-BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Arg(10000);
-BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Arg(100000);
-BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way)->Arg(1000000);
+BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way_fused)
+  ->Arg(1000)->Arg(100000)->Arg(1000000)->Arg(10000000);
+BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way_trusted)
+  ->Arg(1000)->Arg(100000)->Arg(1000000)->Arg(10000000);
+
+// range(1) is the thread count; wall time is what scales.
+BENCHMARK_DEFINE_F(sorted_merge_3way_fixture, BM_sorted_merge_3way_parallel)(benchmark::State& state) {
+  for (auto _ : state) {
+    sorted_merge_3way_parallel(list_a.data(), list_a.size(),
+                 list_b.data(), list_b.size(),
+                 list_c.data(), list_c.size(),
+                 list_abc.data(), state.range(1));
+  }
+  state.SetItemsProcessed(state.iterations() * 3 * state.range(0));
+}
+
+BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_3way_parallel)
+  ->ArgNames({"n", "threads"})
+  ->ArgsProduct({{1000000, 10000000}, {1, 2, 4, 8, 16, 32}})
+  ->UseRealTime();
+
+// The k = range(1) smallest of three lists of range(0) each, and the element
+// of rank range(1) alone; compare with BM_sorted_merge_3way_trusted at the
+// same n for the cost of the full merge.
+BENCHMARK_DEFINE_F(sorted_merge_3way_fixture, BM_sorted_merge_topk)(benchmark::State& state) {
+  for (auto _ : state)
+    benchmark::DoNotOptimize(sorted_merge_topk(list_a.data(), list_a.size(),
+        list_b.data(), list_b.size(), list_c.data(), list_c.size(),
+        state.range(1), list_abc.data()));
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+BENCHMARK_DEFINE_F(sorted_merge_3way_fixture, BM_sorted_merge_rank)(benchmark::State& state) {
+  int v;
+  for (auto _ : state) {
+    sorted_merge_rank(list_a.data(), list_a.size(), list_b.data(),
+        list_b.size(), list_c.data(), list_c.size(), state.range(1), &v);
+    benchmark::DoNotOptimize(v);
+  }
+}
+
+BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_topk)
+  ->ArgNames({"n", "k"})
+  ->ArgsProduct({{1000000, 10000000}, {10, 1000, 100000}});
+BENCHMARK_REGISTER_F(sorted_merge_3way_fixture, BM_sorted_merge_rank)
+  ->ArgNames({"n", "r"})
+  ->ArgsProduct({{1000000, 10000000}, {10, 1000000}});
+
+// k sorted runs of range(1) elements each, merged in a single pass.
+class sorted_merge_kway_fixture : public benchmark::Fixture {
+public:
+  void SetUp(const ::benchmark::State& state) {
+    unsigned k = state.range(0);
+    int size = state.range(1);
+    lists.resize(k);
+    runs.resize(k);
+    for (unsigned i = 0; i < k; ++i) {
+      fill_sorted_list(lists[i], size);
+      runs[i].data = lists[i].data();
+      runs[i].n = lists[i].size();
+    }
+    list_out.resize((size_t) k * size);
+  }
+
+  std::vector<std::vector<int>> lists;
+  std::vector<merge_run> runs;
+  std::vector<int> list_out;
+};
+
+BENCHMARK_DEFINE_F(sorted_merge_kway_fixture, BM_sorted_merge_kway)(benchmark::State& state) {
+  for (auto _ : state)
+    sorted_merge_kway(runs.data(), runs.size(), list_out.data());
+  state.SetItemsProcessed(state.iterations() * list_out.size());
+}
+
+// Total output fixed at 2^20 elements while k grows
+BENCHMARK_REGISTER_F(sorted_merge_kway_fixture, BM_sorted_merge_kway)
+  ->ArgNames({"k", "n"})
+  ->Args({2, 1 << 19})->Args({3, 349525})->Args({4, 1 << 18})
+  ->Args({8, 1 << 17})->Args({16, 1 << 16})->Args({32, 1 << 15})
+  ->Args({64, 1 << 14})->Args({128, 1 << 13})->Args({256, 1 << 12});
+
+// Pulls the merge of the kway fixture through a cursor in batches of range(2)
+// and folds each batch into a checksum while it is still in cache, instead of
+// writing a full-size output.
+BENCHMARK_DEFINE_F(sorted_merge_kway_fixture, BM_merge_cursor)(benchmark::State& state) {
+  std::vector<merge_source> src(runs.size());
+  std::vector<int> batch(state.range(2));
+  for (size_t i = 0; i < runs.size(); ++i)
+    src[i] = { runs[i].data, runs[i].n, NULL, NULL };
+  for (auto _ : state) {
+    merge_cursor *c = merge_cursor_create(src.data(), src.size());
+    long long sum = 0;
+    size_t n;
+    while ((n = merge_cursor_next_batch(c, batch.data(), batch.size())) > 0)
+      for (size_t i = 0; i < n; ++i)
+        sum += batch[i];
+    benchmark::DoNotOptimize(sum);
+    merge_cursor_destroy(c);
+  }
+  state.SetItemsProcessed(state.iterations() * list_out.size());
+}
+
+BENCHMARK_REGISTER_F(sorted_merge_kway_fixture, BM_merge_cursor)
+  ->ArgNames({"k", "n", "batch"})
+  ->Args({3, 349525, 256})->Args({3, 349525, 4096})
+  ->Args({16, 1 << 16, 256})->Args({16, 1 << 16, 4096});
+
+// Header-only typed merge of three lists of T, n elements each.
+template <class T>
+static void
+BM_sorted_merge_typed(benchmark::State& state)
+{
+  size_t n = state.range(0);
+  std::vector<int> keys;
+  std::vector<T> lists[3], out(3 * n);
+  merge_span<T> in[3];
+
+  for (int i = 0; i < 3; ++i) {
+    fill_sorted_list(keys, n);
+    lists[i].assign(keys.begin(), keys.end());
+    in[i] = { lists[i].data(), n };
+  }
+  for (auto _ : state)
+    sorted_merge_trusted(in, out.data());
+  state.SetItemsProcessed(state.iterations() * 3 * n);
+  state.SetBytesProcessed(state.iterations() * 3 * n * sizeof(T));
+}
+
+BENCHMARK_TEMPLATE(BM_sorted_merge_typed, int)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_sorted_merge_typed, int64_t)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_sorted_merge_typed, uint32_t)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_sorted_merge_typed, float)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_sorted_merge_typed, double)->Arg(1000)->Arg(1000000);
+
+// 2^16 independent merges of three lists of range(0) elements each, laid
+// out back to back. BM_sorted_merge_3way_loop calls sorted_merge_3way() per
+// merge; BM_sorted_merge_3way_batch runs them as one checked batch on
+// range(1) threads.
+class sorted_merge_batch_fixture : public benchmark::Fixture {
+public:
+  void SetUp(const ::benchmark::State& state) {
+    size_t n = state.range(0), count = 1 << 16;
+    std::vector<int> l;
+    data.resize(3 * n * count);
+    out.resize(3 * n * count);
+    for (int i = 0; i < 3; ++i) {
+      p[i].resize(count);
+      len[i].assign(count, n);
+    }
+    po.resize(count);
+    ok.reset(new bool[count]);
+    for (size_t j = 0; j < count; ++j) {
+      for (int i = 0; i < 3; ++i) {
+        fill_sorted_list(l, n);
+        int *d = &data[(3 * j + i) * n];
+        std::copy(l.begin(), l.end(), d);
+        p[i][j] = d;
+      }
+      po[j] = &out[3 * n * j];
+    }
+    batch = { p[0].data(), len[0].data(), p[1].data(), len[1].data(),
+        p[2].data(), len[2].data(), po.data(), count };
+  }
+
+  std::vector<int> data, out;
+  std::vector<const int *> p[3];
+  std::vector<size_t> len[3];
+  std::vector<int *> po;
+  std::unique_ptr<bool[]> ok;
+  merge3_batch batch;
+};
+
+BENCHMARK_DEFINE_F(sorted_merge_batch_fixture, BM_sorted_merge_3way_loop)(benchmark::State& state) {
+  int n = state.range(0);
+  for (auto _ : state)
+    for (size_t j = 0; j < batch.count; ++j)
+      sorted_merge_3way(p[0][j], n, p[1][j], n, p[2][j], n, po[j]);
+  state.SetItemsProcessed(state.iterations() * out.size());
+}
+
+BENCHMARK_DEFINE_F(sorted_merge_batch_fixture, BM_sorted_merge_3way_batch)(benchmark::State& state) {
+  for (auto _ : state)
+    sorted_merge_3way_batch(&batch, ok.get(), state.range(1));
+  state.SetItemsProcessed(state.iterations() * out.size());
+}
+
+BENCHMARK_REGISTER_F(sorted_merge_batch_fixture, BM_sorted_merge_3way_loop)
+  ->ArgName("n")->Arg(2)->Arg(5)->Arg(10)->Arg(30)->Arg(100);
+BENCHMARK_REGISTER_F(sorted_merge_batch_fixture, BM_sorted_merge_3way_batch)
+  ->ArgNames({"n", "threads"})
+  ->ArgsProduct({{2, 5, 10, 30, 100}, {1, 4}})
+  ->UseRealTime();
+
+// Set operations on three lists: list_a holds range(0) / range(1) elements
+// and the other two range(0), so range(1) = 1000 shows the exponential search
+// paying off when one list is much smaller.
+template <typename SetOp>
+static void
+run_set_3way(benchmark::State& state, SetOp op)
+{
+  size_t n = state.range(0);
+  std::vector<int> a, b, c, out(3 * n);
+
+  fill_sorted_list(a, n / state.range(1));
+  fill_sorted_list(b, n);
+  fill_sorted_list(c, n);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(op(a.data(), a.size(), b.data(), b.size(),
+        c.data(), c.size(), out.data()));
+  state.SetItemsProcessed(state.iterations() * (a.size() + 2 * n));
+}
+
+static void
+BM_sorted_union_3way(benchmark::State& state)
+{
+  run_set_3way(state, sorted_union_3way);
+}
+
+static void
+BM_sorted_intersect_3way(benchmark::State& state)
+{
+  run_set_3way(state, sorted_intersect_3way);
+}
+
+// values in at least two of the three lists
+static void
+BM_sorted_threshold_3way(benchmark::State& state)
+{
+  run_set_3way(state, [](const int *a, size_t na, const int *b, size_t nb,
+      const int *c, size_t nc, int *out) {
+    return sorted_threshold_3way(a, na, b, nb, c, nc, 2, out);
+  });
+}
+
+static void
+BM_sorted_difference_3way(benchmark::State& state)
+{
+  run_set_3way(state, sorted_difference_3way);
+}
+
+static void
+set_3way_args(benchmark::internal::Benchmark *b)
+{
+  b->ArgNames({"n", "ratio"})->ArgsProduct({{100000, 1000000}, {1, 1000}});
+}
+
+BENCHMARK(BM_sorted_union_3way)->Apply(set_3way_args);
+BENCHMARK(BM_sorted_intersect_3way)->Apply(set_3way_args);
+BENCHMARK(BM_sorted_threshold_3way)->Apply(set_3way_args);
+BENCHMARK(BM_sorted_difference_3way)->Apply(set_3way_args);
+
+BENCHMARK_DEFINE_F(sorted_merge_kway_fixture, BM_sorted_union_kway)(benchmark::State& state) {
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+        sorted_union_kway(runs.data(), runs.size(), list_out.data()));
+  state.SetItemsProcessed(state.iterations() * list_out.size());
+}
+
+BENCHMARK_DEFINE_F(sorted_merge_kway_fixture, BM_sorted_intersect_kway)(benchmark::State& state) {
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+        sorted_intersect_kway(runs.data(), runs.size(), list_out.data()));
+  state.SetItemsProcessed(state.iterations() * list_out.size());
+}
+
+// values in at least half of the runs
+BENCHMARK_DEFINE_F(sorted_merge_kway_fixture, BM_sorted_threshold_kway)(benchmark::State& state) {
+  unsigned m = (runs.size() + 1) / 2;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+        sorted_threshold_kway(runs.data(), runs.size(), m, list_out.data()));
+  state.SetItemsProcessed(state.iterations() * list_out.size());
+}
+
+BENCHMARK_DEFINE_F(sorted_merge_kway_fixture, BM_sorted_difference_kway)(benchmark::State& state) {
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+        sorted_difference_kway(runs.data(), runs.size(), list_out.data()));
+  state.SetItemsProcessed(state.iterations() * list_out.size());
+}
+
+BENCHMARK_REGISTER_F(sorted_merge_kway_fixture, BM_sorted_union_kway)
+  ->ArgNames({"k", "n"})
+  ->Args({4, 1 << 18})->Args({16, 1 << 16})->Args({128, 1 << 13});
+BENCHMARK_REGISTER_F(sorted_merge_kway_fixture, BM_sorted_intersect_kway)
+  ->ArgNames({"k", "n"})
+  ->Args({4, 1 << 18})->Args({16, 1 << 16})->Args({128, 1 << 13});
+BENCHMARK_REGISTER_F(sorted_merge_kway_fixture, BM_sorted_threshold_kway)
+  ->ArgNames({"k", "n"})
+  ->Args({4, 1 << 18})->Args({16, 1 << 16})->Args({128, 1 << 13});
+BENCHMARK_REGISTER_F(sorted_merge_kway_fixture, BM_sorted_difference_kway)
+  ->ArgNames({"k", "n"})
+  ->Args({4, 1 << 18})->Args({16, 1 << 16})->Args({128, 1 << 13});
+
+// Sorting range(0) random ints: merge_sort() on range(1) threads against
+// std::sort. Each iteration sorts a fresh copy of the same input; the copy
+// is excluded from the timing.
+static void
+BM_merge_sort(benchmark::State& state)
+{
+  size_t n = state.range(0);
+  std::mt19937 gen(7);
+  std::vector<int> in(n), v(n), tmp(n);
+  for (int &x : in)
+    x = gen();
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::copy(in.begin(), in.end(), v.begin());
+    state.ResumeTiming();
+    merge_sort_buf(v.data(), n, tmp.data(), state.range(1));
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void
+BM_std_sort(benchmark::State& state)
+{
+  size_t n = state.range(0);
+  std::mt19937 gen(7);
+  std::vector<int> in(n), v(n);
+  for (int &x : in)
+    x = gen();
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::copy(in.begin(), in.end(), v.begin());
+    state.ResumeTiming();
+    std::sort(v.begin(), v.end());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_merge_sort)
+  ->ArgNames({"n", "threads"})
+  ->ArgsProduct({{1000, 100000, 1000000, 10000000}, {1, 2, 4, 8, 0}})
+  ->Unit(benchmark::kMicrosecond)
+  ->UseRealTime();
+BENCHMARK(BM_std_sort)
+  ->ArgName("n")->Arg(1000)->Arg(100000)->Arg(1000000)->Arg(10000000)
+  ->Unit(benchmark::kMicrosecond)
+  ->UseRealTime();
+
+// A field of /proc/self/status in kB, or 0 where it is not available.
+static size_t
+proc_status_kb(const char *key)
+{
+  FILE *f = fopen("/proc/self/status", "r");
+  char line[256];
+  size_t kb = 0, len = strlen(key);
+  if (!f)
+    return 0;
+  while (fgets(line, sizeof(line), f))
+    if (!strncmp(line, key, len) && line[len] == ':')
+      kb = strtoull(line + len + 1, NULL, 10);
+  fclose(f);
+  return kb;
+}
+
+// Returns freed heap pages to the kernel and restarts VmHWM from the current
+// resident size (Linux clear_refs), so the next peak belongs to what runs next.
+static void
+reset_peak_rss()
+{
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+  FILE *f = fopen("/proc/self/clear_refs", "w");
+  if (f) {
+    fputs("5", f);
+    fclose(f);
+  }
+}
+
+// Three adjacent runs of range(0) / 3 ints each merged inside one array
+// (range(1) = 1) or into a separate output (range(1) = 0), with the values
+// interleaved (range(2) = 0) or the runs disjoint and in reverse order
+// (range(2) = 1). The runs are restored before each iteration, untimed; the
+// out-of-place output is allocated once, as callers would reuse it.
+//
+// peak_rss_MB is the process peak resident size during one extra merge that
+// allocates everything it needs (output array or scratch), and extra_MB its
+// growth over the resident size just before, i.e. the memory the merge
+// itself costs on top of the input.
+static void
+BM_sorted_merge_3way_inplace(benchmark::State& state)
+{
+  size_t n = state.range(0) / 3, total = 3 * n;
+  bool inplace = state.range(1), disjoint = state.range(2);
+  std::mt19937 gen(13);
+  std::vector<int> in(total), v(total);
+  for (size_t i = 0; i < total; ++i)
+    in[i] = disjoint ? (int) (total - (i / n + 1) * n + i % n) : (int) (gen() >> 1);
+  for (int r = 0; r < 3; ++r)
+    std::sort(in.begin() + r * n, in.begin() + (r + 1) * n);
+
+  v = in;
+  reset_peak_rss();
+  size_t rss0 = proc_status_kb("VmRSS");
+  if (inplace) {
+    sorted_merge_3way_inplace(v.data(), n, n, n);
+  } else {
+    int *out = (int *) malloc(total * sizeof(int));
+    sorted_merge_3way64(v.data(), n, v.data() + n, n, v.data() + 2 * n, n, out);
+    benchmark::DoNotOptimize(out[total / 2]);
+    free(out);
+  }
+  size_t hwm = proc_status_kb("VmHWM");
+  if (hwm) {
+    state.counters["peak_rss_MB"] = hwm / 1024.0;
+    state.counters["extra_MB"] = hwm > rss0 ? (hwm - rss0) / 1024.0 : 0.0;
+  }
+
+  std::vector<int> out(inplace ? 0 : total);
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::copy(in.begin(), in.end(), v.begin());
+    state.ResumeTiming();
+    if (inplace)
+      sorted_merge_3way_inplace(v.data(), n, n, n);
+    else
+      sorted_merge_3way64(v.data(), n, v.data() + n, n, v.data() + 2 * n, n,
+          out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * total);
+}
+
+BENCHMARK(BM_sorted_merge_3way_inplace)
+  ->ArgNames({"n", "inplace", "disjoint"})
+  ->ArgsProduct({{3 << 10, 3 << 16, 3 << 20, 3 << 24}, {0, 1}, {0, 1}})
+  ->Unit(benchmark::kMicrosecond);
+
+// Three delta-varint lists of range(0) / 3 values each, gaps drawn from
+// 0..range(1), merged into a varint output either by decoding them whole,
+// merging the int arrays and encoding the result (range(2) = 0), or block by
+// block with sorted_merge_varint() (range(2) = 1). Each iteration allocates
+// what it needs; peak_rss_MB and extra_MB are measured as in
+// BM_sorted_merge_3way_inplace, and bytes_per_value is the output size.
+static size_t
+merge_varint_decode_all(const varint_list *in, unsigned char *out)
+{
+  size_t n[3] = { in[0].n, in[1].n, in[2].n }, total = n[0] + n[1] + n[2];
+  int *v = (int *) malloc(total * sizeof(int)), *abc = (int *) malloc(total * sizeof(int));
+  varint_decode(&in[0], v);
+  varint_decode(&in[1], v + n[0]);
+  varint_decode(&in[2], v + n[0] + n[1]);
+  sorted_merge_3way64(v, n[0], v + n[0], n[1], v + n[0] + n[1], n[2], abc);
+  size_t bytes = varint_encode(abc, total, out);
+  free(abc);
+  free(v);
+  return bytes;
+}
+
+static void
+BM_sorted_merge_varint(benchmark::State& state)
+{
+  size_t n = state.range(0) / 3;
+  bool streaming = state.range(2);
+  std::mt19937 gen(17);
+  std::uniform_int_distribution<int> gap(0, state.range(1));
+  std::vector<unsigned char> enc[3];
+  varint_list in[3];
+  std::vector<int> v(n);
+  for (int l = 0; l < 3; ++l) {
+    int64_t x = INT_MIN;
+    for (int &y : v)
+      y = (int) std::min<int64_t>(x += gap(gen), INT_MAX);
+    enc[l].resize(VARINT_MAX_BYTES(n));
+    enc[l].resize(varint_encode(v.data(), n, enc[l].data()));
+    in[l] = { enc[l].data(), enc[l].size(), n };
+  }
+  std::vector<int>().swap(v);
+  std::vector<unsigned char> out(VARINT_MAX_BYTES(3 * n));
+
+  reset_peak_rss();
+  size_t rss0 = proc_status_kb("VmRSS");
+  size_t bytes = streaming ? sorted_merge_varint(in, 3, out.data()) :
+      merge_varint_decode_all(in, out.data());
+  size_t hwm = proc_status_kb("VmHWM");
+  if (hwm) {
+    state.counters["peak_rss_MB"] = hwm / 1024.0;
+    state.counters["extra_MB"] = hwm > rss0 ? (hwm - rss0) / 1024.0 : 0.0;
+  }
+  state.counters["bytes_per_value"] = (double) bytes / (3 * n);
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(streaming ? sorted_merge_varint(in, 3, out.data()) :
+        merge_varint_decode_all(in, out.data()));
+  state.SetItemsProcessed(state.iterations() * 3 * n);
+}
+
+BENCHMARK(BM_sorted_merge_varint)
+  ->ArgNames({"n", "gap", "streaming"})
+  ->ArgsProduct({{3 << 20, 3 << 24}, {8, 250}, {0, 1}})
+  ->Unit(benchmark::kMicrosecond);
+
+// range(0) merges of 3 inputs fed by producer threads that push chunks of
+// 4096 sorted values with a 50 us sleep after each, like slow decompressors.
+// range(1) = 0 gives every merge its own thread pulling from a merge_cursor
+// whose refill blocks on a bounded chunk queue; range(1) = 1 runs all merges
+// as merge_stage's on one shared merge_executor. cpu_ms is the CPU time of
+// the whole process per iteration and merge_threads the threads that merge.
+#define ASYNC_BM_CHUNK 4096
+#define ASYNC_BM_VALUES (1 << 16)
+#define ASYNC_BM_DELAY_US 50
+
+struct bm_channel {
+  std::mutex lock;
+  std::condition_variable cv;
+  std::deque<std::vector<int>> chunks;
+  std::vector<int> cur;
+  bool closed = false;
+};
+
+static bool
+bm_channel_refill(void *ctx, const int **data, size_t *n)
+{
+  bm_channel *ch = (bm_channel *) ctx;
+  std::unique_lock<std::mutex> l(ch->lock);
+  ch->cv.wait(l, [ch] { return ch->closed || !ch->chunks.empty(); });
+  if (ch->chunks.empty())
+    return false;
+  ch->cur.swap(ch->chunks.front());
+  ch->chunks.pop_front();
+  ch->cv.notify_all();
+  *data = ch->cur.data();
+  *n = ch->cur.size();
+  return true;
+}
+
+// Sends the chunks of one input, to a channel holding at most 16 chunks or
+// to a stage.
+static void
+bm_produce(bm_channel *ch, merge_stage *st, unsigned input, unsigned seed)
+{
+  std::minstd_rand gen(seed);
+  std::vector<int> chunk(ASYNC_BM_CHUNK);
+  int x = 0;
+  for (int done = 0; done < ASYNC_BM_VALUES; done += ASYNC_BM_CHUNK) {
+    for (int &y : chunk)
+      y = x += gen() % 16;
+    if (st) {
+      merge_stage_push(st, input, chunk.data(), chunk.size());
+    } else {
+      std::unique_lock<std::mutex> l(ch->lock);
+      ch->cv.wait(l, [ch] { return ch->chunks.size() < 16; });
+      ch->chunks.push_back(chunk);
+      ch->cv.notify_all();
+    }
+    usleep(ASYNC_BM_DELAY_US);
+  }
+  if (st) {
+    merge_stage_close(st, input);
+  } else {
+    std::lock_guard<std::mutex> g(ch->lock);
+    ch->closed = true;
+    ch->cv.notify_all();
+  }
+}
+
+static void
+bm_async_sink(void *ctx, const int *data, size_t n)
+{
+  if (n)
+    *(int64_t *) ctx += data[n - 1];
+}
+
+static void
+bm_blocking_merge(bm_channel *ch, int64_t *sink)
+{
+  merge_source src[3];
+  for (int i = 0; i < 3; ++i)
+    src[i] = { NULL, 0, bm_channel_refill, &ch[i] };
+  merge_cursor *c = merge_cursor_create(src, 3);
+  std::vector<int> out(ASYNC_BM_CHUNK);
+  size_t n;
+  while ((n = merge_cursor_next_batch(c, out.data(), out.size())))
+    *sink += out[n - 1];
+  merge_cursor_destroy(c);
+}
+
+static double
+process_cpu_ms()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+  return t.tv_sec * 1e3 + t.tv_nsec * 1e-6;
+}
+
+static void
+BM_merge_async(benchmark::State& state)
+{
+  unsigned m = state.range(0);
+  bool async = state.range(1);
+  merge_executor *ex = async ? merge_executor_create() : NULL;
+  std::vector<int64_t> sink(m);
+  double cpu = process_cpu_ms();
+
+  for (auto _ : state) {
+    std::vector<std::thread> threads;
+    std::vector<merge_stage *> st(m);
+    std::unique_ptr<bm_channel[]> ch(new bm_channel[3 * m]);
+    for (unsigned i = 0; i < m; ++i) {
+      if (async)
+        st[i] = merge_stage_create(ex, 3, 0, bm_async_sink, &sink[i]);
+      else
+        threads.emplace_back(bm_blocking_merge, &ch[3 * i], &sink[i]);
+      for (unsigned j = 0; j < 3; ++j)
+        threads.emplace_back(bm_produce, &ch[3 * i + j], st[i], j, 3 * i + j + 1);
+    }
+    for (std::thread &t : threads)
+      t.join();
+    for (merge_stage *s : st)
+      merge_stage_destroy(s);
+  }
+  merge_executor_destroy(ex);
+  benchmark::DoNotOptimize(sink.data());
+  state.counters["cpu_ms"] = (process_cpu_ms() - cpu) / state.iterations();
+  state.counters["merge_threads"] = async ? 1 : m;
+  state.SetItemsProcessed(state.iterations() * 3 * m * ASYNC_BM_VALUES);
+}
+
+BENCHMARK(BM_merge_async)
+  ->ArgNames({"merges", "async"})
+  ->ArgsProduct({{4, 64, 256}, {0, 1}})
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+// k sorted files of 2^24 / k ints each (64 MB in all) merged into a file in /tmp;
+// range(1) turns on double-buffered writes. The files stay in the page cache,
+// so this measures the merge and copy path rather than the disk.
+class sorted_merge_files_fixture : public benchmark::Fixture {
+public:
+  void SetUp(const ::benchmark::State& state) {
+    unsigned k = state.range(0);
+    std::vector<int> list;
+    for (unsigned i = 0; i < k; ++i) {
+      char path[] = "/tmp/bm-merge-files-XXXXXX";
+      int fd = mkstemp(path);
+      fill_sorted_list(list, (1 << 24) / k);
+      if (write(fd, list.data(), list.size() * sizeof(int)) < 0)
+        perror("write");
+      close(fd);
+      paths.push_back(path);
+    }
+    for (const std::string &p : paths)
+      inputs.push_back(p.c_str());
+    output = "/tmp/bm-merge-files-out";
+  }
+
+  void TearDown(const ::benchmark::State&) {
+    for (const std::string &p : paths)
+      unlink(p.c_str());
+    unlink(output.c_str());
+    paths.clear();
+    inputs.clear();
+  }
+
+  std::vector<std::string> paths;
+  std::vector<const char *> inputs;
+  std::string output;
+};
+
+BENCHMARK_DEFINE_F(sorted_merge_files_fixture, BM_sorted_merge_files)(benchmark::State& state) {
+  merge_file_opts opts = { 0, state.range(1) != 0, false };
+  for (auto _ : state)
+    sorted_merge_files(inputs.data(), inputs.size(), output.c_str(), &opts);
+  int64_t total = inputs.size() * (int64_t) ((1 << 24) / inputs.size());
+  state.SetBytesProcessed(state.iterations() * total * sizeof(int));
+}
+
+BENCHMARK_REGISTER_F(sorted_merge_files_fixture, BM_sorted_merge_files)
+  ->ArgNames({"k", "overlap"})
+  ->ArgsProduct({{3, 16, 128}, {0, 1}})
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
 
 BENCHMARK_MAIN();
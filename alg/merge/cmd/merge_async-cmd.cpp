@@ -0,0 +1,170 @@
+/* R. Fabbri, 2025 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+
+#include <merge_async.h>
+
+/*
+ * Demo of asynchronous merge stages: m merges of k inputs each share one
+ * executor thread, fed by k * m producer threads that generate sorted values
+ * and sleep between pushes, standing in for slow decompressors or readers.
+ *
+ *   merge_async-cmd [-m merges] [-k inputs] [-n values] [-c chunk] [-d usec]
+ *                   [-q queue]
+ *
+ *   -m merges  concurrent merges (default 8)
+ *   -k inputs  inputs per merge (default 3)
+ *   -n values  values per input (default 1M)
+ *   -c chunk   values per push (default 4096)
+ *   -d usec    producer sleep after each push (default 100)
+ *   -q queue   queue length of each input in values (default 64K)
+ *
+ * Every output is checked for order and length. Reports the elapsed time,
+ * the merged values per second and the CPU time of the whole process, which
+ * stays far below one core per merge since no thread waits busily.
+ */
+struct merge_check {
+  size_t count;
+  int last;
+  bool sorted;
+  bool ended;
+};
+
+struct producer_args {
+  merge_stage *stage;
+  unsigned input;
+  size_t n, chunk;
+  unsigned delay_us;
+  uint32_t seed;
+};
+
+static void
+usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-m merges] [-k inputs] [-n values] [-c chunk] "
+      "[-d usec] [-q queue]\n", prog);
+  exit(2);
+}
+
+static double
+now()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static double
+cpu_seconds()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void
+check_output(void *ctx, const int *data, size_t n)
+{
+  merge_check *c = (merge_check *) ctx;
+  if (!n)
+    c->ended = true;
+  for (size_t i = 0; i < n; i++) {
+    c->sorted &= data[i] >= c->last;
+    c->last = data[i];
+  }
+  c->count += n;
+}
+
+/* sorted values with random gaps of 0..15 */
+static void
+produce(producer_args a)
+{
+  std::vector<int> buf(a.chunk);
+  uint32_t s = a.seed;
+  int x = 0;
+
+  for (size_t done = 0; done < a.n; ) {
+    size_t m = a.n - done < a.chunk ? a.n - done : a.chunk;
+    for (size_t i = 0; i < m; i++) {
+      s = s * 1103515245u + 12345u;
+      buf[i] = x += s >> 28;
+    }
+    merge_stage_push(a.stage, a.input, buf.data(), m);
+    done += m;
+    if (a.delay_us)
+      usleep(a.delay_us);
+  }
+  merge_stage_close(a.stage, a.input);
+}
+
+int
+main(int argc, char **argv)
+{
+  unsigned m = 8, k = 3, delay_us = 100;
+  size_t n = 1000000, chunk = 4096, queue = 0;
+  int c;
+
+  while ((c = getopt(argc, argv, "m:k:n:c:d:q:")) != -1) {
+    switch (c) {
+    case 'm': m = strtoul(optarg, NULL, 10); break;
+    case 'k': k = strtoul(optarg, NULL, 10); break;
+    case 'n': n = strtoull(optarg, NULL, 10); break;
+    case 'c': chunk = strtoull(optarg, NULL, 10); break;
+    case 'd': delay_us = strtoul(optarg, NULL, 10); break;
+    case 'q': queue = strtoull(optarg, NULL, 10); break;
+    default: usage(argv[0]);
+    }
+  }
+  if (argc != optind || !m || !chunk || n > (size_t) INT32_MAX / 16)
+    usage(argv[0]);
+
+  merge_executor *ex = merge_executor_create();
+  if (!ex) {
+    fprintf(stderr, "Error: cannot start the executor.\n");
+    return 1;
+  }
+  std::vector<merge_check> checks(m, merge_check { 0, INT32_MIN, true, false });
+  std::vector<merge_stage *> stages(m);
+  std::vector<std::thread> producers;
+
+  double t0 = now(), c0 = cpu_seconds();
+  for (unsigned i = 0; i < m; i++) {
+    stages[i] = merge_stage_create(ex, k, queue, check_output, &checks[i]);
+    if (!stages[i]) {
+      fprintf(stderr, "Error: out of memory.\n");
+      return 1;
+    }
+  }
+  for (unsigned i = 0; i < m; i++)
+    for (unsigned j = 0; j < k; j++)
+      producers.emplace_back(produce,
+          producer_args { stages[i], j, n, chunk, delay_us, 7919 * i + j + 1 });
+  for (std::thread &t : producers)
+    t.join();
+  for (unsigned i = 0; i < m; i++)
+    merge_stage_destroy(stages[i]);
+  double t1 = now(), c1 = cpu_seconds();
+  merge_executor_destroy(ex);
+
+  for (unsigned i = 0; i < m; i++) {
+    if (!checks[i].ended || checks[i].count != k * n) {
+      fprintf(stderr, "Error: merge %u emitted %zu of %zu values.\n", i,
+          checks[i].count, k * n);
+      return 1;
+    }
+    if (!checks[i].sorted) {
+      fprintf(stderr, "Error: merge %u is out of order.\n", i);
+      return 1;
+    }
+  }
+  double total = (double) m * k * n;
+  printf("%u merges x %u inputs x %zu values: %.3f s, %.1f M values/s, "
+      "process CPU %.3f s\n", m, k, n, t1 - t0,
+      t1 > t0 ? total / (t1 - t0) / 1e6 : 0.0, c1 - c0);
+  return 0;
+}
@@ -1,51 +1,297 @@
 /* R. Fabbri, 2024 */
-#include <iostream>
-
-// Hardcoded sizes based on original jl.c test cases
-#define NA_SIZE 3
-#define NB_SIZE 4
-#define NC_SIZE 2
-#define TOTAL_SIZE (NA_SIZE + NB_SIZE + NC_SIZE)
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <charconv>
+#include <limits>
 
 #include <sorted_merge_3way.h>
+#include <merge_dispatch.h>
+
+/*
+ * Merges three sorted integer lists read from stdin and writes the result to
+ * stdout.
+ *
+ *   sorted_merge_3way-cmd [-i] [-o] [-p] [-s bytes] [-t threads] [-v]
+ *                         [na nb nc]
+ *
+ *   na nb nc    list lengths; without them and without -p, 3 4 2 as in the
+ *               original jl.c test cases
+ *   -p          each list is preceded by its length: a count in text mode,
+ *               a native uint64 in binary mode
+ *   -i          binary input: native int32 values, no separators
+ *   -o          binary output: native int32 values
+ *   -s bytes    write outputs of at least this size with non-temporal
+ *               stores (see merge_dispatch.h)
+ *   -t threads  merge on this many threads (0 = all cores)
+ *   -v          report read, merge and write times and rates on stderr
+ *
+ * Text values are decimal, with an optional sign and leading zeros, and are
+ * separated by any whitespace. Text output is each value
+ * followed by a space, then a newline.
+ */
+#define IO_BUF (1 << 20)
+/* longest int token without leading zeros, plus a separator */
+#define TOKEN_MAX 16
+
+struct reader {
+  char *buf;
+  size_t pos, end;
+  bool eof;
+};
+
+static void
+usage(const char *prog)
+{
+  fprintf(stderr,
+      "Usage: %s [-i] [-o] [-p] [-s bytes] [-t threads] [-v] [na nb nc]\n",
+      prog);
+  exit(2);
+}
+
+/* a plain decimal count: no sign, no trailing characters */
+static bool
+parse_count(const char *s, unsigned long long *v)
+{
+  char *end;
+
+  if (*s < '0' || *s > '9')
+    return false;
+  *v = strtoull(s, &end, 10);
+  return !*end;
+}
+
+static void
+fail(const char *msg)
+{
+  fprintf(stderr, "Error: %s\n", msg);
+  exit(1);
+}
+
+static double
+seconds(const struct timespec *t0, const struct timespec *t1)
+{
+  return (t1->tv_sec - t0->tv_sec) + (t1->tv_nsec - t0->tv_nsec) * 1e-9;
+}
+
+/* reads up to n bytes from stdin, returning fewer only at end of input */
+static size_t
+read_full(void *dst, size_t n)
+{
+  size_t got = 0;
+
+  while (got < n) {
+    ssize_t r = read(0, (char *) dst + got, n - got);
+    if (r < 0)
+      fail("cannot read input.");
+    if (!r)
+      break;
+    got += r;
+  }
+  return got;
+}
+
+/* keeps at least a full token buffered unless the input has ended */
+static void
+refill(reader *r)
+{
+  memmove(r->buf, r->buf + r->pos, r->end - r->pos);
+  r->end -= r->pos;
+  r->pos = 0;
+  size_t got = read_full(r->buf + r->end, IO_BUF - r->end);
+  r->eof = r->end + got < IO_BUF;
+  r->end += got;
+}
+
+/*
+ * Parses the next whitespace-separated decimal integer of type T. As with
+ * iostreams, it may have a sign and any number of leading zeros: they are
+ * skipped first, so that only the significant digits need to be buffered.
+ */
+template <class T>
+static bool
+next_value(reader *r, T *v)
+{
+  for (;;) {
+    if (r->end - r->pos < TOKEN_MAX && !r->eof)
+      refill(r);
+    while (r->pos < r->end && (unsigned char) r->buf[r->pos] <= ' ')
+      r->pos++;
+    if (r->pos < r->end)
+      break;
+    if (r->eof)
+      return false;
+  }
+  bool neg = r->buf[r->pos] == '-';
+  if (neg || r->buf[r->pos] == '+')
+    r->pos++;
+  for (;;) {
+    if (r->end - r->pos < TOKEN_MAX && !r->eof)
+      refill(r);
+    if (r->end - r->pos < 2 || r->buf[r->pos] != '0' ||
+        r->buf[r->pos + 1] < '0' || r->buf[r->pos + 1] > '9')
+      break;
+    r->pos++;
+  }
+  const char *p = r->buf + r->pos, *e = r->buf + r->end;
+  uint64_t mag;
+  std::from_chars_result res = std::from_chars(p, e, mag);
+  if (res.ec != std::errc() || (res.ptr == e && !r->eof) ||
+      (res.ptr < e && (unsigned char) *res.ptr > ' '))
+    return false;
+  /* the magnitude must fit T, down to its minimum when negative */
+  uint64_t max = std::numeric_limits<T>::max();
+  if (neg ? mag && (!std::numeric_limits<T>::is_signed || mag - 1 > max) :
+      mag > max)
+    return false;
+  *v = (T) (neg ? 0 - mag : mag);
+  r->pos = res.ptr - r->buf;
+  return true;
+}
+
+static size_t
+read_length(reader *r, bool binary)
+{
+  uint64_t n;
+
+  if (binary ? read_full(&n, sizeof(n)) != sizeof(n) : !next_value(r, &n))
+    fail("Invalid input or premature end of input.");
+  return n;
+}
+
+static int *
+read_list(reader *r, bool binary, size_t n)
+{
+  int *v = (int *) malloc(n ? n * sizeof(int) : 1);
+
+  if (!v)
+    fail("out of memory.");
+  if (binary) {
+    if (read_full(v, n * sizeof(int)) != n * sizeof(int))
+      fail("Invalid input or premature end of input.");
+    return v;
+  }
+  for (size_t i = 0; i < n; i++)
+    if (!next_value(r, &v[i]))
+      fail("Invalid input or premature end of input.");
+  return v;
+}
+
+static void
+write_text(const int *v, size_t n)
+{
+  char *buf = (char *) malloc(IO_BUF + TOKEN_MAX);
+  size_t len = 0;
+
+  if (!buf)
+    fail("out of memory.");
+  for (size_t i = 0; i < n; i++) {
+    len = std::to_chars(buf + len, buf + IO_BUF + TOKEN_MAX, v[i]).ptr - buf;
+    buf[len++] = ' ';
+    if (len >= IO_BUF) {
+      fwrite(buf, 1, len, stdout);
+      len = 0;
+    }
+  }
+  buf[len++] = '\n';
+  fwrite(buf, 1, len, stdout);
+  free(buf);
+}
 
 int
-main()
-{
-  int list_a[NA_SIZE];
-  int list_b[NB_SIZE];
-  int list_c[NC_SIZE];
-  int list_abc[TOTAL_SIZE];
-
-  // Read elements directly from stdin
-  for (int i = 0; i < NA_SIZE; ++i)
-    std::cin >> list_a[i];
-  for (int i = 0; i < NB_SIZE; ++i)
-    std::cin >> list_b[i];
-  for (int i = 0; i < NC_SIZE; ++i)
-    std::cin >> list_c[i];
-
-  // Check for input errors (e.g., non-numeric input, EOF)
-  if (std::cin.fail()) {
-    std::cerr << "Error: Invalid input or premature end of input." << std::endl;
-    return 1;
-  }
-
-  bool res = sorted_merge_3way(
-    list_a, NA_SIZE,
-    list_b, NB_SIZE,
-    list_c, NC_SIZE,
-    list_abc
-  );
-
-  if (!res) {
-    std::cerr << "Error: An input list was not sorted." << std::endl;
-    return 1;
-  }
-  
-  for (int i = 0; i < TOTAL_SIZE; ++i)
-    std::cout << list_abc[i] << " ";
-  std::cout << std::endl;
+main(int argc, char **argv)
+{
+  bool bin_in = false, bin_out = false, prefixed = false, verbose = false;
+  unsigned nthreads = 1;
+  unsigned long long v;
+  size_t n[3] = { 3, 4, 2 };
+  int *list[3];
+  struct timespec t0, t1, t2, t3;
+  int c;
+
+  while ((c = getopt(argc, argv, "iops:t:v")) != -1) {
+    switch (c) {
+    case 'i': bin_in = true; break;
+    case 'o': bin_out = true; break;
+    case 'p': prefixed = true; break;
+    case 's':
+      if (!parse_count(optarg, &v) || v > SIZE_MAX)
+        usage(argv[0]);
+      merge_set_stream_threshold(v);
+      break;
+    case 't':
+      if (!parse_count(optarg, &v) || v > std::numeric_limits<unsigned>::max())
+        usage(argv[0]);
+      nthreads = v;
+      break;
+    case 'v': verbose = true; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (argc - optind == 3) {
+    if (prefixed)
+      usage(argv[0]);
+    for (int i = 0; i < 3; i++) {
+      if (!parse_count(argv[optind + i], &v) || v > SIZE_MAX)
+        usage(argv[0]);
+      n[i] = v;
+    }
+  } else if (argc != optind) {
+    usage(argv[0]);
+  }
+
+  reader r = { (char *) malloc(IO_BUF), 0, 0, false };
+  if (!r.buf)
+    fail("out of memory.");
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < 3; i++) {
+    if (prefixed)
+      n[i] = read_length(&r, bin_in);
+    if (n[i] > SIZE_MAX / sizeof(int) / 3)
+      fail("list too long.");
+    list[i] = read_list(&r, bin_in, n[i]);
+  }
+  size_t total = n[0] + n[1] + n[2];
+  int *list_abc = (int *) malloc(total ? total * sizeof(int) : 1);
+  if (!list_abc)
+    fail("out of memory.");
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  bool res = nthreads == 1 ?
+      sorted_merge_3way64(list[0], n[0], list[1], n[1], list[2], n[2],
+          list_abc) :
+      sorted_merge_3way_parallel(list[0], n[0], list[1], n[1], list[2], n[2],
+          list_abc, nthreads);
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  if (!res)
+    fail("An input list was not sorted.");
+
+  if (bin_out)
+    fwrite(list_abc, sizeof(int), total, stdout);
+  else
+    write_text(list_abc, total);
+  if (fflush(stdout))
+    fail("cannot write output.");
+  clock_gettime(CLOCK_MONOTONIC, &t3);
+
+  if (verbose) {
+    double sr = seconds(&t0, &t1), sm = seconds(&t1, &t2);
+    double sw = seconds(&t2, &t3);
+    fprintf(stderr, "%zu ints: read %.3f s (%.1f M/s), "
+        "merge %.3f s (%.1f M/s, %.1f MB/s), write %.3f s (%.1f M/s)\n",
+        total, sr, sr > 0 ? total / sr / 1e6 : 0.0,
+        sm, sm > 0 ? total / sm / 1e6 : 0.0,
+        sm > 0 ? 2 * total * sizeof(int) / sm / 1e6 : 0.0,
+        sw, sw > 0 ? total / sw / 1e6 : 0.0);
+  }
 
+  for (int i = 0; i < 3; i++)
+    free(list[i]);
+  free(list_abc);
+  free(r.buf);
   return 0;
 }
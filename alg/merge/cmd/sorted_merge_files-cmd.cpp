@@ -0,0 +1,106 @@
+/* R. Fabbri, 2025 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sorted_merge_files.h>
+
+/*
+ * Merges sorted files of raw little-endian int32 into one output file.
+ *
+ *   sorted_merge_files-cmd [-c] [-o] [-v] [-b elems] output input...
+ *
+ *   -c        check that every input is sorted
+ *   -o        overlap writing with merging (double buffering)
+ *   -v        report elapsed time and throughput on stderr
+ *   -b elems  output buffer length in ints (default 4M)
+ */
+static void
+usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-c] [-o] [-v] [-b elems] output input...\n", prog);
+  exit(2);
+}
+
+/* parses a positive decimal count; false on garbage, 0 or overflow */
+static bool
+parse_count(const char *s, size_t *n)
+{
+  char *end;
+  unsigned long long v;
+
+  if (*s < '0' || *s > '9')
+    return false;
+  errno = 0;
+  v = strtoull(s, &end, 10);
+  if (errno || *end || !v || v > SIZE_MAX)
+    return false;
+  *n = v;
+  return true;
+}
+
+int
+main(int argc, char **argv)
+{
+  merge_file_opts opts = { 0, false, false };
+  bool verbose = false;
+  struct timespec t0, t1;
+  int c;
+
+  while ((c = getopt(argc, argv, "cob:v")) != -1) {
+    switch (c) {
+    case 'c': opts.check = true; break;
+    case 'o': opts.overlap_io = true; break;
+    case 'v': verbose = true; break;
+    case 'b':
+      if (!parse_count(optarg, &opts.buffer_elems)) {
+        fprintf(stderr, "Error: invalid buffer length '%s'.\n", optarg);
+        return 2;
+      }
+      break;
+    default: usage(argv[0]);
+    }
+  }
+  if (argc - optind < 2)
+    usage(argv[0]);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  merge_file_status st = sorted_merge_files(
+      (const char *const *) argv + optind + 1, argc - optind - 1,
+      argv[optind], &opts);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  switch (st) {
+  case MERGE_FILE_OK:
+    break;
+  case MERGE_FILE_IO:
+    fprintf(stderr, "Error: %s\n", strerror(errno));
+    return 1;
+  case MERGE_FILE_FORMAT:
+    fprintf(stderr, "Error: an input size is not a multiple of 4 bytes.\n");
+    return 1;
+  case MERGE_FILE_UNSORTED:
+    fprintf(stderr, "Error: an input file was not sorted.\n");
+    return 1;
+  case MERGE_FILE_NOMEM:
+    fprintf(stderr, "Error: out of memory.\n");
+    return 1;
+  }
+
+  if (verbose) {
+    FILE *f = fopen(argv[optind], "rb");
+    double s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    long bytes = 0;
+    if (f && !fseek(f, 0, SEEK_END))
+      bytes = ftell(f);
+    if (f)
+      fclose(f);
+    fprintf(stderr, "%ld bytes in %.3f s, %.1f MB/s\n", bytes, s,
+        s > 0 ? bytes / s / 1e6 : 0.0);
+  }
+  return 0;
+}
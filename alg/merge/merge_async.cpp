@@ -0,0 +1,315 @@
+/* R. Fabbri, 2025 */
+#include "merge_async.h"
+#include "merge_kernels.h"
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#define ASYNC_QUEUE_DEFAULT (1 << 16)
+/* values merged per callback */
+#define ASYNC_BATCH 4096
+/* batches per turn before the executor moves on to the next stage */
+#define ASYNC_TURN 16
+
+/*
+ * Each input queue is a ring buffer with one producer and one consumer.
+ * head and count change under the stage lock, but values are copied in and
+ * merged out without it: the producer only writes past head + count and the
+ * executor only reads below it.
+ */
+struct async_input {
+  int *ring;
+  size_t head, count;
+  bool closed;
+};
+
+enum stage_state {
+  STAGE_IDLE,     /* waiting for a push or close */
+  STAGE_QUEUED,   /* in the executor's ready queue */
+  STAGE_RUNNING,
+  STAGE_DONE      /* final callback returned */
+};
+
+struct merge_stage {
+  merge_executor *ex;
+  unsigned k;
+  size_t cap;
+  async_input *in;
+  merge_run *win;
+  size_t *split;
+  int *out;
+  merge_emit_fn emit;
+  void *ctx;
+  std::mutex lock;
+  std::condition_variable space, done;
+  stage_state state;
+};
+
+struct merge_executor {
+  std::mutex lock;
+  std::condition_variable wake;
+  std::deque<merge_stage *> ready;
+  bool stop;
+  std::thread thread;
+};
+
+static void
+enqueue(merge_stage *s)
+{
+  merge_executor *ex = s->ex;
+  {
+    std::lock_guard<std::mutex> g(ex->lock);
+    ex->ready.push_back(s);
+  }
+  ex->wake.notify_one();
+}
+
+/* call with s->lock held; returns whether the caller must enqueue s */
+static bool
+mark_ready(merge_stage *s)
+{
+  if (s->state != STAGE_IDLE)
+    return false;
+  s->state = STAGE_QUEUED;
+  return true;
+}
+
+/*
+ * One turn of s on the executor. Each round takes the contiguous part of
+ * every queue, bounds it by the last value of each input that may still
+ * grow, merges at most ASYNC_BATCH values and hands them to the callback.
+ * Returns when an open input runs dry (the stage goes idle), when all input
+ * is consumed (done), or after ASYNC_TURN rounds (queued again).
+ */
+static void
+run_stage(merge_stage *s)
+{
+  unsigned k = s->k;
+  merge_run *win = s->win;
+
+  for (unsigned round = 0; round < ASYNC_TURN; round++) {
+    bool bounded = false, finished = true;
+    int bound = INT_MAX;
+    size_t total = 0;
+
+    {
+      std::lock_guard<std::mutex> g(s->lock);
+      for (unsigned i = 0; i < k; i++) {
+        async_input *q = &s->in[i];
+        size_t seg = q->count < s->cap - q->head ? q->count : s->cap - q->head;
+        bool more = !q->closed || seg < q->count;
+        if (more && !seg) {
+          s->state = STAGE_IDLE;
+          return;
+        }
+        win[i].data = q->ring + q->head;
+        win[i].n = seg;
+        if (more && q->ring[q->head + seg - 1] <= bound) {
+          bound = q->ring[q->head + seg - 1];
+          bounded = true;
+        }
+        finished &= !more && !seg;
+      }
+    }
+    if (finished) {
+      s->emit(s->ctx, NULL, 0);
+      std::lock_guard<std::mutex> g(s->lock);
+      s->state = STAGE_DONE;
+      s->done.notify_all();
+      return;
+    }
+
+    for (unsigned i = 0; i < k; i++) {
+      if (bounded)
+        win[i].n = gallop_upper(win[i].data, win[i].n, bound);
+      total += win[i].n;
+    }
+    if (total > ASYNC_BATCH) {
+      total = ASYNC_BATCH;
+      for (unsigned i = 0; i < k; i++)
+        win[i].n = win[i].n < total ? win[i].n : total;
+      corank_kway(win, k, total, s->split);
+      for (unsigned i = 0; i < k; i++)
+        win[i].n = s->split[i];
+    }
+    /* only k > 3 allocates; out of memory, try again on a later turn */
+    if (!mergek_kernel(win, k, s->out))
+      break;
+    s->emit(s->ctx, s->out, total);
+
+    {
+      std::lock_guard<std::mutex> g(s->lock);
+      for (unsigned i = 0; i < k; i++) {
+        async_input *q = &s->in[i];
+        q->head = (q->head + win[i].n) % s->cap;
+        q->count -= win[i].n;
+      }
+    }
+    s->space.notify_all();
+  }
+
+  {
+    std::lock_guard<std::mutex> g(s->lock);
+    s->state = STAGE_QUEUED;
+  }
+  enqueue(s);
+}
+
+static void
+executor_loop(merge_executor *ex)
+{
+  for (;;) {
+    merge_stage *s;
+    {
+      std::unique_lock<std::mutex> l(ex->lock);
+      ex->wake.wait(l, [ex] { return ex->stop || !ex->ready.empty(); });
+      if (ex->ready.empty())
+        return;
+      s = ex->ready.front();
+      ex->ready.pop_front();
+    }
+    {
+      std::lock_guard<std::mutex> g(s->lock);
+      s->state = STAGE_RUNNING;
+    }
+    run_stage(s);
+  }
+}
+
+merge_executor *
+merge_executor_create()
+{
+  merge_executor *ex = new (std::nothrow) merge_executor;
+  if (!ex)
+    return NULL;
+  ex->stop = false;
+  try {
+    ex->thread = std::thread(executor_loop, ex);
+  } catch (...) {
+    delete ex;
+    return NULL;
+  }
+  return ex;
+}
+
+void
+merge_executor_destroy(merge_executor *ex)
+{
+  if (!ex)
+    return;
+  {
+    std::lock_guard<std::mutex> g(ex->lock);
+    ex->stop = true;
+  }
+  ex->wake.notify_one();
+  ex->thread.join();
+  delete ex;
+}
+
+merge_stage *
+merge_stage_create(merge_executor *ex, unsigned k, size_t queue_len,
+    merge_emit_fn emit, void *ctx)
+{
+  merge_stage *s = new (std::nothrow) merge_stage;
+  if (!s)
+    return NULL;
+  s->ex = ex;
+  s->k = k;
+  s->cap = queue_len ? queue_len : ASYNC_QUEUE_DEFAULT;
+  s->emit = emit;
+  s->ctx = ctx;
+  s->state = STAGE_IDLE;
+  s->in = (async_input *) calloc(k ? k : 1, sizeof(async_input));
+  s->win = (merge_run *) malloc((k ? k : 1) * sizeof(merge_run));
+  s->split = (size_t *) malloc((k ? k : 1) * sizeof(size_t));
+  s->out = (int *) malloc(ASYNC_BATCH * sizeof(int));
+  bool ok = s->in && s->win && s->split && s->out;
+  for (unsigned i = 0; ok && i < k; i++)
+    ok = (s->in[i].ring = (int *) malloc(s->cap * sizeof(int))) != NULL;
+  if (!ok) {
+    for (unsigned i = 0; s->in && i < k; i++)
+      free(s->in[i].ring);
+    free(s->in);
+    free(s->win);
+    free(s->split);
+    free(s->out);
+    delete s;
+    return NULL;
+  }
+  /* with no inputs there is nothing to wait for */
+  if (!k) {
+    s->state = STAGE_QUEUED;
+    enqueue(s);
+  }
+  return s;
+}
+
+void
+merge_stage_push(merge_stage *s, unsigned input, const int *data, size_t n)
+{
+  async_input *q = &s->in[input];
+
+  while (n) {
+    size_t tail, m;
+    {
+      std::unique_lock<std::mutex> l(s->lock);
+      s->space.wait(l, [s, q] { return q->count < s->cap; });
+      tail = (q->head + q->count) % s->cap;
+      m = s->cap - q->count;
+      if (m > s->cap - tail)
+        m = s->cap - tail;
+      if (m > n)
+        m = n;
+    }
+    memcpy(q->ring + tail, data, m * sizeof(int));
+    bool wake;
+    {
+      std::lock_guard<std::mutex> g(s->lock);
+      q->count += m;
+      wake = mark_ready(s);
+    }
+    if (wake)
+      enqueue(s);
+    data += m;
+    n -= m;
+  }
+}
+
+void
+merge_stage_close(merge_stage *s, unsigned input)
+{
+  bool wake;
+  {
+    std::lock_guard<std::mutex> g(s->lock);
+    s->in[input].closed = true;
+    wake = mark_ready(s);
+  }
+  if (wake)
+    enqueue(s);
+}
+
+void
+merge_stage_wait(merge_stage *s)
+{
+  std::unique_lock<std::mutex> l(s->lock);
+  s->done.wait(l, [s] { return s->state == STAGE_DONE; });
+}
+
+void
+merge_stage_destroy(merge_stage *s)
+{
+  if (!s)
+    return;
+  merge_stage_wait(s);
+  for (unsigned i = 0; i < s->k; i++)
+    free(s->in[i].ring);
+  free(s->in);
+  free(s->win);
+  free(s->split);
+  free(s->out);
+  delete s;
+}
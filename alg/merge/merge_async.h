@@ -0,0 +1,74 @@
+/* R. Fabbri, 2025 */
+#ifndef MERGE_ASYNC_H
+#define MERGE_ASYNC_H
+
+#include <cstddef>
+
+/*
+ * Asynchronous merge stages.
+ *
+ * A merge_stage merges k sorted inputs whose values arrive over time from
+ * producer threads, such as decompressors or file readers. Every input has a
+ * bounded queue: merge_stage_push() copies values in and blocks while the
+ * queue is full, which holds back producers that run ahead of the merge.
+ *
+ * The merging runs on the thread of a merge_executor, and only when it can
+ * make progress. A stage with an open input whose queue is empty is
+ * suspended and costs nothing until the push that refills it schedules it
+ * again, so no thread blocks waiting on a slow source. Many stages share one
+ * executor thread; each turn merges a bounded amount before the next ready
+ * stage gets the thread.
+ *
+ * A value is emitted once it is final: no greater than the last value
+ * queued on every input still open, the same rule as merge_cursor. The
+ * callback gets the output in batches on the executor thread, then once
+ * with n = 0 after every input has been closed and drained. A slow callback
+ * delays the other stages of the executor.
+ *
+ * Each input must have a single producer thread, and its values must be
+ * sorted across pushes; this is not checked.
+ */
+typedef void (*merge_emit_fn)(void *ctx, const int *data, size_t n);
+
+struct merge_executor;
+struct merge_stage;
+
+/* @return  A new executor with its own thread, or NULL on failure. */
+merge_executor *
+merge_executor_create();
+
+/* Stops the executor's thread. Its stages must all be destroyed first. */
+void
+merge_executor_destroy(merge_executor *ex);
+
+/*
+ * @param ex         Executor that runs the merge.
+ * @param k          Number of inputs, numbered 0..k-1.
+ * @param queue_len  Values each input queue holds; 0 selects 64K.
+ * @param emit       Output callback, called on the executor thread.
+ * @return           A new stage, or NULL if out of memory.
+ */
+merge_stage *
+merge_stage_create(merge_executor *ex, unsigned k, size_t queue_len,
+    merge_emit_fn emit, void *ctx);
+
+/* Queues data[0, n) on the input, blocking while its queue is full. */
+void
+merge_stage_push(merge_stage *s, unsigned input, const int *data, size_t n);
+
+/* Marks the end of the input; nothing may be pushed to it afterwards. */
+void
+merge_stage_close(merge_stage *s, unsigned input);
+
+/* Blocks until the final (n = 0) callback has returned. */
+void
+merge_stage_wait(merge_stage *s);
+
+/*
+ * Waits as merge_stage_wait() and releases the stage. Every input must have
+ * been closed.
+ */
+void
+merge_stage_destroy(merge_stage *s);
+
+#endif /* MERGE_ASYNC_H */
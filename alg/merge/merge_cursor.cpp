@@ -0,0 +1,144 @@
+/* R. Fabbri, 2025 */
+#include "merge_cursor.h"
+#include "merge_kernels.h"
+#include <cstdlib>
+
+/*
+ * Up to three sources are merged in bulk by the regular kernels. Any value
+ * no greater than the last value of every refillable chunk can be emitted
+ * without seeing more data, so each round takes from every chunk the prefix
+ * up to that bound, trims the total to the room left with a co-rank split
+ * and merges it in one kernel call.
+ *
+ * More sources go through a loser tree that lives in the cursor and is
+ * replayed one output at a time, refilling a source when its chunk runs dry.
+ */
+struct merge_cursor {
+  unsigned k;
+  merge_source *src;
+  uint64_t *tree;   /* k > 3 only */
+  uint64_t winner;
+};
+
+/* makes src non-empty unless its stream has ended */
+static void
+fill(merge_source *s)
+{
+  while (!s->n && s->refill)
+    if (!s->refill(s->ctx, &s->data, &s->n)) {
+      s->refill = NULL;
+      s->n = 0;
+    }
+}
+
+static inline uint64_t
+head_key(const merge_source *s, unsigned r)
+{
+  return s->n ? run_key(*s->data, r) : KEY_DONE;
+}
+
+merge_cursor *
+merge_cursor_create(const merge_source *src, unsigned k)
+{
+  merge_cursor *c = (merge_cursor *) malloc(sizeof(merge_cursor));
+  if (!c)
+    return NULL;
+  c->k = k;
+  c->winner = KEY_DONE;
+  c->src = (merge_source *) malloc((k ? k : 1) * sizeof(merge_source));
+  /* tree[k..3k) is only used while building */
+  c->tree = k > 3 ? (uint64_t *) malloc(3 * (size_t) k * sizeof(uint64_t)) : NULL;
+  if (!c->src || (k > 3 && !c->tree)) {
+    merge_cursor_destroy(c);
+    return NULL;
+  }
+  for (unsigned i = 0; i < k; i++) {
+    c->src[i] = src[i];
+    fill(&c->src[i]);
+  }
+  if (k > 3) {
+    uint64_t *win = c->tree + k;
+    for (unsigned i = 0; i < k; i++)
+      win[k + i] = head_key(&c->src[i], i);
+    c->winner = loser_tree_build(c->tree, k);
+  }
+  return c;
+}
+
+static size_t
+next_batch_small(merge_cursor *c, int *out, size_t max)
+{
+  merge_source *s = c->src;
+  unsigned k = c->k;
+  size_t done = 0, split[3];
+  merge_run win[3];
+
+  while (done < max) {
+    bool bounded = false;
+    int bound = INT_MAX;
+    size_t total = 0;
+
+    for (unsigned i = 0; i < k; i++) {
+      fill(&s[i]);
+      if (s[i].refill && s[i].data[s[i].n - 1] <= bound) {
+        bound = s[i].data[s[i].n - 1];
+        bounded = true;
+      }
+    }
+    for (unsigned i = 0; i < k; i++) {
+      win[i].data = s[i].data;
+      win[i].n = bounded ? gallop_upper(s[i].data, s[i].n, bound) : s[i].n;
+      total += win[i].n;
+    }
+    if (!total)
+      break;
+    if (total > max - done) {
+      total = max - done;
+      for (unsigned i = 0; i < k; i++)
+        win[i].n = win[i].n < total ? win[i].n : total;
+      corank_kway(win, k, total, split);
+      for (unsigned i = 0; i < k; i++)
+        win[i].n = split[i];
+    }
+    mergek_kernel(win, k, out + done);
+    for (unsigned i = 0; i < k; i++) {
+      s[i].data += win[i].n;
+      s[i].n -= win[i].n;
+    }
+    done += total;
+  }
+  return done;
+}
+
+size_t
+merge_cursor_next_batch(merge_cursor *c, int *out, size_t max)
+{
+  if (c->k <= 3)
+    return next_batch_small(c, out, max);
+
+  uint64_t w = c->winner, *tree = c->tree;
+  unsigned k = c->k;
+  size_t t;
+
+  for (t = 0; t < max && w != KEY_DONE; t++) {
+    unsigned r = (unsigned) w;
+    merge_source *s = &c->src[r];
+    out[t] = key_value(w);
+    s->data++;
+    s->n--;
+    fill(s);
+    w = loser_tree_replay(tree, k, r, head_key(s, r));
+  }
+  c->winner = w;
+  return t;
+}
+
+void
+merge_cursor_destroy(merge_cursor *c)
+{
+  if (!c)
+    return;
+  free(c->src);
+  free(c->tree);
+  free(c);
+}
@@ -0,0 +1,57 @@
+/* R. Fabbri, 2025 */
+#ifndef MERGE_CURSOR_H
+#define MERGE_CURSOR_H
+
+#include <cstddef>
+
+/*
+ * Pull-based streaming merge.
+ *
+ * A merge_cursor merges k sorted sources lazily: each call to
+ * merge_cursor_next_batch() writes up to `max` more merged values, so the
+ * caller can work through a small cache-resident buffer and fuse its own
+ * processing with the merge instead of materializing the whole output.
+ *
+ * A source is either a fixed array or a stream of chunks. When a chunk is
+ * used up the cursor calls its refill function for the next one, so
+ * unbounded streams merge in constant memory. The concatenation of a
+ * source's chunks must be sorted; this is not checked.
+ */
+
+/*
+ * Sets *data and *n to the next chunk of the stream and returns `true`, or
+ * returns `false` at the end of the stream. Empty chunks are allowed. The
+ * cursor no longer reads the previous chunk once this is called.
+ */
+typedef bool (*merge_refill_fn)(void *ctx, const int **data, size_t *n);
+
+struct merge_source {
+  const int *data;        /* first chunk, may be empty */
+  size_t n;
+  merge_refill_fn refill; /* NULL if data[0..n) is all there is */
+  void *ctx;              /* passed to refill */
+};
+
+struct merge_cursor;
+
+/*
+ * @param src  The k sources; they are copied, the array can be reused.
+ * @return     A new cursor, or NULL if out of memory. Release it with
+ *             merge_cursor_destroy().
+ */
+merge_cursor *
+merge_cursor_create(const merge_source *src, unsigned k);
+
+/*
+ * Writes the next merged values to out.
+ *
+ * @return  The number of values written, at most max; less than max only
+ *          at the end of the merge, after which it returns 0.
+ */
+size_t
+merge_cursor_next_batch(merge_cursor *c, int *out, size_t max);
+
+void
+merge_cursor_destroy(merge_cursor *c);
+
+#endif /* MERGE_CURSOR_H */
@@ -0,0 +1,61 @@
+/* R. Fabbri, 2025 */
+#ifndef MERGE_DISPATCH_H
+#define MERGE_DISPATCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Merge kernels behind sorted_merge_3way(), sorted_merge_kway() and the other
+ * libmerge entry points. MERGE_KERNEL_AUTO picks the fastest kernel the CPU
+ * supports, checked once through CPUID; the others force one kernel, mainly
+ * for benchmarking and testing. All kernels produce identical output.
+ */
+enum merge_kernel {
+  MERGE_KERNEL_AUTO,
+  MERGE_KERNEL_BRANCHY,     /* reference compare-and-branch loop */
+  MERGE_KERNEL_BRANCHLESS,  /* portable, conditional moves only */
+  MERGE_KERNEL_SSE41,       /* 4-wide bitonic merge network */
+  MERGE_KERNEL_AVX2,        /* 8-wide bitonic merge network */
+  MERGE_KERNEL_GALLOP       /* adaptive: bulk-copies long runs of one list
+                               found by exponential search (never picked by
+                               MERGE_KERNEL_AUTO) */
+};
+
+/*
+ * Selects the kernel used from now on by every thread.
+ *
+ * @return  `false` if the kernel is not available on this CPU or build; the
+ *          previous selection is kept in that case.
+ */
+bool
+merge_set_kernel(merge_kernel k);
+
+/*
+ * @return  The kernel currently in use, never MERGE_KERNEL_AUTO.
+ */
+merge_kernel
+merge_get_kernel();
+
+/*
+ * 3-way merges whose output is at least this many bytes write it with
+ * non-temporal stores: the kernel merges into a cache-resident block that is
+ * then streamed to memory, so output lines are neither read for ownership
+ * nor left in the cache, and the inputs are prefetched a block ahead. This
+ * pays off for memory-bound merges (long runs, skewed or disjoint inputs)
+ * with outputs well beyond the last-level cache, and costs a few percent on
+ * compute-bound ones or when the caller reads the result right away. The
+ * threshold applies to each kernel call, so a parallel merge compares the
+ * size of each thread's slice. The mode is opt-in: the default,
+ * MERGE_STREAM_OFF, never streams, and 0 streams every merge. x86 only;
+ * elsewhere the setting is ignored.
+ */
+#define MERGE_STREAM_OFF SIZE_MAX
+
+void
+merge_set_stream_threshold(size_t bytes);
+
+size_t
+merge_get_stream_threshold();
+
+#endif /* MERGE_DISPATCH_H */
@@ -0,0 +1,155 @@
+/* R. Fabbri, 2025 */
+#include "merge_kernels.h"
+#include <cstring>
+
+/*
+ * Galloping kernels, after TimSort. Elements are merged one at a time while
+ * the lists interleave. Once one list has won MIN_GALLOP times in a row, the
+ * kernel finds how far that run extends with an exponential search against
+ * the other heads and copies it with memcpy. Skewed or disjoint inputs (time
+ * partitioned shards, say) then cost O(log run) comparisons per run instead
+ * of one per element. Ties go to the earlier list as in the other kernels.
+ *
+ * With CHECK set the output is compared with the previous element as in the
+ * branchless checked kernels; a copied run is checked for order on its own.
+ */
+#define MIN_GALLOP 7
+
+template <bool CHECK>
+static inline bool
+copy_run(const int *v, size_t n, int *&out, int &prev)
+{
+  if (!n)
+    return true;
+  if (CHECK) {
+    if (*v < prev || !is_sorted_list(v, n))
+      return false;
+    prev = v[n - 1];
+  }
+  memcpy(out, v, n * sizeof(int));
+  out += n;
+  return true;
+}
+
+template <bool CHECK>
+static bool
+merge2_gallop_t(const int *a, size_t na, const int *b, size_t nb, int *out,
+    int prev)
+{
+  const int *ea = a + na, *eb = b + nb;
+  unsigned wins = 0;
+  bool last = false;
+
+  while (a < ea && b < eb) {
+    MERGE_COUNT_CMP(1);
+    bool ta = *a <= *b;
+    int v = ta ? *a : *b;
+    if (CHECK && v < prev)
+      return false;
+    prev = v;
+    *out++ = v;
+    a += ta;
+    b += !ta;
+    wins = ta == last ? wins + 1 : 1;
+    last = ta;
+    if (wins < MIN_GALLOP || a == ea || b == eb)
+      continue;
+    /* a run of a: everything up to b's head; of b: strictly below a's */
+    size_t n = ta ? gallop_upper(a, ea - a, *b) : gallop_lower(b, eb - b, *a);
+    if (!copy_run<CHECK>(ta ? a : b, n, out, prev))
+      return false;
+    a += ta ? n : 0;
+    b += ta ? 0 : n;
+    wins = 0;
+  }
+  return copy_run<CHECK>(a, ea - a, out, prev) &&
+      copy_run<CHECK>(b, eb - b, out, prev);
+}
+
+template <bool CHECK>
+static bool
+merge3_gallop_t(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  const int *ea = a + na, *eb = b + nb, *ec = c + nc;
+  unsigned wins = 0, last = 3;
+  int prev = INT_MIN;
+
+  while (a < ea && b < eb && c < ec) {
+    MERGE_COUNT_CMP(2);
+    int va = *a, vb = *b, vc = *c;
+    int vbc = vb <= vc ? vb : vc;
+    bool ta = va <= vbc;
+    bool tb = !ta & (vb <= vc);
+    bool tc = !ta & !tb;
+    int v = ta ? va : vbc;
+    if (CHECK && v < prev)
+      return false;
+    prev = v;
+    *out++ = v;
+    a += ta;
+    b += tb;
+    c += tc;
+    unsigned src = tb + 2 * tc;
+    wins = src == last ? wins + 1 : 1;
+    last = src;
+    if (wins < MIN_GALLOP || a == ea || b == eb || c == ec)
+      continue;
+
+    /* the run ends before the other heads, counting the tie order */
+    MERGE_COUNT_CMP(1);
+    size_t n;
+    const int *run;
+    if (ta) {
+      run = a;
+      n = gallop_upper(a, ea - a, *b <= *c ? *b : *c);
+      a += n;
+    } else if (tb) {
+      run = b;
+      n = *a <= *c ? gallop_lower(b, eb - b, *a) : gallop_upper(b, eb - b, *c);
+      b += n;
+    } else {
+      run = c;
+      n = gallop_lower(c, ec - c, *a <= *b ? *a : *b);
+      c += n;
+    }
+    if (!copy_run<CHECK>(run, n, out, prev))
+      return false;
+    wins = 0;
+  }
+
+  if (a == ea)
+    return merge2_gallop_t<CHECK>(b, eb - b, c, ec - c, out, prev);
+  if (b == eb)
+    return merge2_gallop_t<CHECK>(a, ea - a, c, ec - c, out, prev);
+  return merge2_gallop_t<CHECK>(a, ea - a, b, eb - b, out, prev);
+}
+
+void
+merge2_gallop(const int *a, size_t na, const int *b, size_t nb, int *out)
+{
+  merge2_gallop_t<false>(a, na, b, nb, out, INT_MIN);
+}
+
+void
+merge3_gallop(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  merge3_gallop_t<false>(a, na, b, nb, c, nc, out);
+}
+
+bool
+merge3_gallop_checked(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  return merge3_gallop_t<true>(a, na, b, nb, c, nc, out);
+}
@@ -0,0 +1,639 @@
+/* R. Fabbri, 2025 */
+#include "merge_kernels.h"
+#include "merge_dispatch.h"
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+bool
+is_sorted_list(const int *v, size_t n)
+{
+  for (size_t i = 1; i < n; i++)
+    if (v[i] < v[i - 1])
+      return false;
+  return true;
+}
+
+size_t
+gallop_lower(const int *v, size_t n, int x)
+{
+  size_t lo = 0, hi = 1;
+
+  /* v[0..lo) < x; grow the probe until v[hi - 1] >= x or the end */
+  while (hi <= n && v[hi - 1] < x) {
+    MERGE_COUNT_CMP(1);
+    lo = hi;
+    hi = 2 * hi + 1;
+  }
+  MERGE_COUNT_CMP(hi <= n);
+  if (hi > n)
+    hi = n;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    MERGE_COUNT_CMP(1);
+    if (v[mid] < x)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+size_t
+corank2(const int *a, size_t na, const int *b, size_t nb, size_t r)
+{
+  size_t lo = r > nb ? r - nb : 0, hi = r < na ? r : na;
+
+  /* smallest i where a[i] no longer precedes b[r - i - 1] */
+  while (lo < hi) {
+    size_t i = lo + (hi - lo) / 2;
+    MERGE_COUNT_CMP(1);
+    if (a[i] <= b[r - i - 1])
+      lo = i + 1;
+    else
+      hi = i;
+  }
+  return lo;
+}
+
+/* number of elements < x (strict) or <= x (!strict) in sorted v */
+static size_t
+count_below(const int *v, size_t n, int x, bool strict)
+{
+  size_t lo = 0, hi = n;
+
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    MERGE_COUNT_CMP(1);
+    if (v[mid] < x || (!strict && v[mid] == x))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/*
+ * Binary search on the key range for the value v of the output at rank r - 1:
+ * the smallest v with at least r elements <= v. Everything below v is taken
+ * from every run, and the copies of v needed to reach r are taken in run
+ * order, which is the tie order of the kernels. Only the first r elements of
+ * each run can matter, and v lies between the smallest head and the r-th
+ * element of any run that has r elements, which keeps the search short.
+ */
+void
+corank_kway(const merge_run *runs, unsigned k, size_t r, size_t *split)
+{
+  long long lo = INT_MAX, hi = INT_MIN, cap = INT_MAX;
+  size_t below = 0;
+
+  if (!r) {
+    for (unsigned i = 0; i < k; i++)
+      split[i] = 0;
+    return;
+  }
+  for (unsigned i = 0; i < k; i++) {
+    size_t n = runs[i].n < r ? runs[i].n : r;
+    if (!n)
+      continue;
+    if (runs[i].data[0] < lo)
+      lo = runs[i].data[0];
+    if (runs[i].data[n - 1] > hi)
+      hi = runs[i].data[n - 1];
+    if (n == r && runs[i].data[n - 1] < cap)
+      cap = runs[i].data[n - 1];
+  }
+  if (cap < hi)
+    hi = cap;
+  while (lo < hi) {
+    long long mid = lo + (hi - lo) / 2;
+    size_t cnt = 0;
+    for (unsigned i = 0; i < k; i++)
+      cnt += count_below(runs[i].data, runs[i].n < r ? runs[i].n : r,
+          (int) mid, false);
+    if (cnt >= r)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  /* the clamps only matter for unsorted input, where they keep sum == r */
+  for (unsigned i = 0; i < k; i++) {
+    split[i] = count_below(runs[i].data, runs[i].n < r ? runs[i].n : r,
+        (int) lo, true);
+    if (split[i] > r - below)
+      split[i] = r - below;
+    below += split[i];
+  }
+  r -= below;
+  for (unsigned i = 0; i < k && r; i++) {
+    size_t n = runs[i].n < r + split[i] ? runs[i].n : r + split[i];
+    size_t eq = count_below(runs[i].data + split[i], n - split[i],
+        (int) lo, false);
+    split[i] += eq;
+    r -= eq;
+  }
+}
+
+void
+merge_run_workers(unsigned nthreads, void (*fn)(void *ctx, unsigned t),
+    void *ctx)
+{
+  std::thread workers[MERGE_MAX_THREADS];
+
+  for (unsigned t = 1; t < nthreads; t++)
+    workers[t] = std::thread(fn, ctx, t);
+  fn(ctx, 0);
+  for (unsigned t = 1; t < nthreads; t++)
+    workers[t].join();
+}
+
+struct merge3_job {
+  const merge_run *runs;
+  size_t total;
+  unsigned nthreads;
+  int *out;
+};
+
+static void
+merge3_slice(void *ctx, unsigned t)
+{
+  const merge3_job *job = (const merge3_job *) ctx;
+  size_t r0 = slice_start(job->total, t, job->nthreads);
+  size_t r1 = slice_start(job->total, t + 1, job->nthreads);
+  size_t s0[3], s1[3];
+  const merge_run *rn = job->runs;
+
+  corank_kway(rn, 3, r0, s0);
+  corank_kway(rn, 3, r1, s1);
+  merge3_kernel(
+      rn[0].data + s0[0], s1[0] - s0[0],
+      rn[1].data + s0[1], s1[1] - s0[1],
+      rn[2].data + s0[2], s1[2] - s0[2],
+      job->out + r0);
+}
+
+void
+merge3_slices(const merge_run runs[3], size_t total, int *out,
+    unsigned nthreads)
+{
+  merge3_job job = { runs, total, nthreads, out };
+  merge_run_workers(nthreads, merge3_slice, &job);
+}
+
+/*
+ * Reference kernels: the original compare-and-branch loop. Once one list runs
+ * dry the rest of the other is block-copied; no sentinel values are used, so
+ * INT_MAX is an ordinary key.
+ */
+void
+merge2_branchy(const int *a, size_t na, const int *b, size_t nb, int *out)
+{
+  const int *ea = a + na, *eb = b + nb;
+
+  while (a < ea && b < eb) {
+    MERGE_COUNT_CMP(1);
+    if (*a <= *b)
+      *out++ = *a++;
+    else
+      *out++ = *b++;
+  }
+  if (a < ea)
+    memcpy(out, a, (ea - a) * sizeof(int));
+  else if (b < eb)
+    memcpy(out, b, (eb - b) * sizeof(int));
+}
+
+void
+merge3_branchy(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  const int *ea = a + na, *eb = b + nb, *ec = c + nc;
+
+  while (a < ea && b < eb && c < ec) {
+    MERGE_COUNT_CMP(*a <= *b && *a > *c ? 3 : 2);
+    if (*a <= *b && *a <= *c)
+      *out++ = *a++;
+    else if (*b <= *c)
+      *out++ = *b++;
+    else
+      *out++ = *c++;
+  }
+
+  /* one list is exhausted: finish with a two-way merge of the others */
+  if (a == ea)
+    merge2_branchy(b, eb - b, c, ec - c, out);
+  else if (b == eb)
+    merge2_branchy(a, ea - a, c, ec - c, out);
+  else
+    merge2_branchy(a, ea - a, b, eb - b, out);
+}
+
+/*
+ * Branchless kernels. The value written is a min computed with conditional
+ * moves and the cursors advance by the comparison results, so random data
+ * costs no mispredictions. If every list has at least m elements left, the
+ * next m outputs cannot run any list dry, so the inner loop runs m times with
+ * no bounds checks at all.
+ */
+void
+merge2_branchless(const int *a, size_t na, const int *b, size_t nb, int *out)
+{
+  const int *ea = a + na, *eb = b + nb;
+
+  for (;;) {
+    size_t m = ea - a < eb - b ? ea - a : eb - b;
+    if (!m)
+      break;
+    MERGE_COUNT_CMP(m);
+    do {
+      int va = *a, vb = *b;
+      bool ta = va <= vb;
+      *out++ = ta ? va : vb;
+      a += ta;
+      b += !ta;
+    } while (--m);
+  }
+  if (a < ea)
+    memcpy(out, a, (ea - a) * sizeof(int));
+  else if (b < eb)
+    memcpy(out, b, (eb - b) * sizeof(int));
+}
+
+void
+merge3_branchless(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  const int *ea = a + na, *eb = b + nb, *ec = c + nc;
+
+  for (;;) {
+    size_t m = ea - a < eb - b ? ea - a : eb - b;
+    if ((size_t) (ec - c) < m)
+      m = ec - c;
+    if (!m)
+      break;
+    MERGE_COUNT_CMP(2 * m);
+    do {
+      int va = *a, vb = *b, vc = *c;
+      int vbc = vb <= vc ? vb : vc;
+      bool ta = va <= vbc;
+      bool tb = !ta & (vb <= vc);
+      *out++ = ta ? va : vbc;
+      a += ta;
+      b += tb;
+      c += !ta & !tb;
+    } while (--m);
+  }
+
+  if (a == ea)
+    merge2_branchless(b, eb - b, c, ec - c, out);
+  else if (b == eb)
+    merge2_branchless(a, ea - a, c, ec - c, out);
+  else
+    merge2_branchless(a, ea - a, b, eb - b, out);
+}
+
+/*
+ * Validating kernels. Every merge keeps the order within each list, so the
+ * output is sorted if and only if all inputs are: an inversion x[i] > x[i + 1]
+ * in a list is emitted in that order and shows up as a descent in the output.
+ * Checking the output therefore needs one compare per element against a
+ * register, instead of a separate pass over the inputs. The branch is never
+ * taken on valid input.
+ */
+static bool
+copy_checked(const int *v, size_t n, int *out, int prev)
+{
+  for (size_t i = 0; i < n; i++) {
+    if (v[i] < prev)
+      return false;
+    out[i] = prev = v[i];
+  }
+  return true;
+}
+
+static bool
+merge2_checked(const int *a, size_t na, const int *b, size_t nb, int *out,
+    int prev)
+{
+  const int *ea = a + na, *eb = b + nb;
+
+  for (;;) {
+    size_t m = ea - a < eb - b ? ea - a : eb - b;
+    if (!m)
+      break;
+    MERGE_COUNT_CMP(m);
+    do {
+      int va = *a, vb = *b;
+      bool ta = va <= vb;
+      int v = ta ? va : vb;
+      if (v < prev)
+        return false;
+      *out++ = prev = v;
+      a += ta;
+      b += !ta;
+    } while (--m);
+  }
+  if (a < ea)
+    return copy_checked(a, ea - a, out, prev);
+  return copy_checked(b, eb - b, out, prev);
+}
+
+bool
+merge2_branchless_checked(const int *a, size_t na, const int *b, size_t nb,
+    int *out)
+{
+  return merge2_checked(a, na, b, nb, out, INT_MIN);
+}
+
+bool
+merge3_branchless_checked(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  const int *ea = a + na, *eb = b + nb, *ec = c + nc;
+  int prev = INT_MIN;
+
+  for (;;) {
+    size_t m = ea - a < eb - b ? ea - a : eb - b;
+    if ((size_t) (ec - c) < m)
+      m = ec - c;
+    if (!m)
+      break;
+    MERGE_COUNT_CMP(2 * m);
+    do {
+      int va = *a, vb = *b, vc = *c;
+      int vbc = vb <= vc ? vb : vc;
+      bool ta = va <= vbc;
+      bool tb = !ta & (vb <= vc);
+      int v = ta ? va : vbc;
+      if (v < prev)
+        return false;
+      *out++ = prev = v;
+      a += ta;
+      b += tb;
+      c += !ta & !tb;
+    } while (--m);
+  }
+
+  if (a == ea)
+    return merge2_checked(b, eb - b, c, ec - c, out, prev);
+  if (b == eb)
+    return merge2_checked(a, ea - a, c, ec - c, out, prev);
+  return merge2_checked(a, ea - a, b, eb - b, out, prev);
+}
+
+/*
+ * Kernel dispatch. The pointers start at resolvers that run the CPUID check
+ * on first use; relaxed atomics are enough since every thread that races to
+ * resolve stores the same pointers.
+ */
+static void resolve_merge2(const int *, size_t, const int *, size_t, int *);
+static void resolve_merge3(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *);
+
+static std::atomic<merge2_fn> merge2_impl(resolve_merge2);
+static bool resolve_merge3_checked(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *);
+
+static std::atomic<merge3_fn> merge3_impl(resolve_merge3);
+static std::atomic<merge3_check_fn> merge3_checked_impl(resolve_merge3_checked);
+static std::atomic<merge_kernel> kernel_in_use(MERGE_KERNEL_AUTO);
+static std::atomic<size_t> stream_bytes(MERGE_STREAM_OFF);
+
+static bool
+kernel_supported(merge_kernel k)
+{
+  switch (k) {
+  case MERGE_KERNEL_AUTO:
+  case MERGE_KERNEL_BRANCHY:
+  case MERGE_KERNEL_BRANCHLESS:
+  case MERGE_KERNEL_GALLOP:
+    return true;
+#ifdef MERGE_HAVE_X86_SIMD
+  case MERGE_KERNEL_SSE41:
+    return __builtin_cpu_supports("sse4.1");
+  case MERGE_KERNEL_AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+bool
+merge_set_kernel(merge_kernel k)
+{
+  merge2_fn m2 = merge2_branchless;
+  merge3_fn m3 = merge3_branchless;
+  merge3_check_fn m3c = merge3_branchless_checked;
+
+  if (!kernel_supported(k))
+    return false;
+  if (k == MERGE_KERNEL_AUTO) {
+    k = MERGE_KERNEL_BRANCHLESS;
+    if (kernel_supported(MERGE_KERNEL_SSE41))
+      k = MERGE_KERNEL_SSE41;
+    if (kernel_supported(MERGE_KERNEL_AVX2))
+      k = MERGE_KERNEL_AVX2;
+  }
+  switch (k) {
+  case MERGE_KERNEL_BRANCHY:
+    m2 = merge2_branchy;
+    m3 = merge3_branchy;
+    break;
+  case MERGE_KERNEL_GALLOP:
+    m2 = merge2_gallop;
+    m3 = merge3_gallop;
+    m3c = merge3_gallop_checked;
+    break;
+#ifdef MERGE_HAVE_X86_SIMD
+  case MERGE_KERNEL_SSE41:
+    m2 = merge2_sse41;
+    m3 = merge3_sse41;
+    m3c = merge3_sse41_checked;
+    break;
+  case MERGE_KERNEL_AVX2:
+    m2 = merge2_avx2;
+    m3 = merge3_avx2;
+    m3c = merge3_avx2_checked;
+    break;
+#endif
+  default:
+    break;
+  }
+  merge2_impl.store(m2, std::memory_order_relaxed);
+  merge3_impl.store(m3, std::memory_order_relaxed);
+  merge3_checked_impl.store(m3c, std::memory_order_relaxed);
+  kernel_in_use.store(k, std::memory_order_relaxed);
+  return true;
+}
+
+merge_kernel
+merge_get_kernel()
+{
+  if (kernel_in_use.load(std::memory_order_relaxed) == MERGE_KERNEL_AUTO)
+    merge_set_kernel(MERGE_KERNEL_AUTO);
+  return kernel_in_use.load(std::memory_order_relaxed);
+}
+
+static void
+resolve_merge2(const int *a, size_t na, const int *b, size_t nb, int *out)
+{
+  merge_set_kernel(MERGE_KERNEL_AUTO);
+  merge2_kernel(a, na, b, nb, out);
+}
+
+static void
+resolve_merge3(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  merge_set_kernel(MERGE_KERNEL_AUTO);
+  merge3_kernel(a, na, b, nb, c, nc, out);
+}
+
+static bool
+resolve_merge3_checked(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  merge_set_kernel(MERGE_KERNEL_AUTO);
+  return merge3_checked(a, na, b, nb, c, nc, out);
+}
+
+void
+merge2_kernel(const int *a, size_t na, const int *b, size_t nb, int *out)
+{
+  merge2_impl.load(std::memory_order_relaxed)(a, na, b, nb, out);
+  MERGE_RECORD(a, na, b, nb, NULL, 0);
+}
+
+void
+merge_set_stream_threshold(size_t bytes)
+{
+  stream_bytes.store(bytes, std::memory_order_relaxed);
+}
+
+size_t
+merge_get_stream_threshold()
+{
+  return stream_bytes.load(std::memory_order_relaxed);
+}
+
+#ifdef MERGE_HAVE_X86_SIMD
+/* resolves first, so the block kernels loaded next are never the resolvers */
+static inline bool
+use_stream(size_t n)
+{
+  size_t t = stream_bytes.load(std::memory_order_relaxed);
+  if (n < t / sizeof(int) + (t % sizeof(int) != 0))
+    return false;
+  merge_get_kernel();
+  return true;
+}
+#endif
+
+void
+merge3_kernel(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+#ifdef MERGE_HAVE_X86_SIMD
+  if (use_stream(na + nb + nc)) {
+    merge3_stream(a, na, b, nb, c, nc, out,
+        merge3_impl.load(std::memory_order_relaxed));
+    MERGE_RECORD(a, na, b, nb, c, nc);
+    return;
+  }
+#endif
+  merge3_impl.load(std::memory_order_relaxed)(a, na, b, nb, c, nc, out);
+  MERGE_RECORD(a, na, b, nb, c, nc);
+}
+
+bool
+merge3_checked(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+#ifdef MERGE_HAVE_X86_SIMD
+  if (use_stream(na + nb + nc)) {
+    bool ok = merge3_stream_checked(a, na, b, nb, c, nc, out,
+        merge3_checked_impl.load(std::memory_order_relaxed));
+    MERGE_RECORD(a, na, b, nb, c, nc);
+    return ok;
+  }
+#endif
+  bool ok = merge3_checked_impl.load(std::memory_order_relaxed)(
+      a, na, b, nb, c, nc, out);
+  MERGE_RECORD(a, na, b, nb, c, nc);
+  return ok;
+}
+
+bool
+mergek_kernel(const merge_run *runs, unsigned k, int *out)
+{
+  switch (k) {
+  case 0:
+    return true;
+  case 1:
+    if (runs[0].n)
+      memcpy(out, runs[0].data, runs[0].n * sizeof(int));
+    return true;
+  case 2:
+    merge2_kernel(runs[0].data, runs[0].n, runs[1].data, runs[1].n, out);
+    return true;
+  case 3:
+    merge3_kernel(runs[0].data, runs[0].n, runs[1].data, runs[1].n,
+        runs[2].data, runs[2].n, out);
+    return true;
+  }
+
+  uint64_t *tree = (uint64_t *) malloc(3 * (size_t) k * sizeof(uint64_t));
+  const int **cur = (const int **) malloc(2 * (size_t) k * sizeof(int *));
+  if (!tree || !cur) {
+    free(tree);
+    free(cur);
+    return false;
+  }
+  uint64_t *win = tree + k;
+  const int **end = cur + k;
+  size_t total = 0;
+
+  for (unsigned i = 0; i < k; i++) {
+    cur[i] = runs[i].data;
+    end[i] = runs[i].data + runs[i].n;
+    total += runs[i].n;
+    win[k + i] = runs[i].n ? run_key(*cur[i], i) : KEY_DONE;
+  }
+
+  uint64_t w = loser_tree_build(tree, k);
+  for (size_t t = 0; t < total; t++) {
+    unsigned r = (unsigned) w;
+    out[t] = key_value(w);
+    w = ++cur[r] < end[r] ? run_key(*cur[r], r) : KEY_DONE;
+    w = loser_tree_replay(tree, k, r, w);
+  }
+
+  free(tree);
+  free(cur);
+  return true;
+}
@@ -0,0 +1,244 @@
+/* R. Fabbri, 2025 */
+#ifndef MERGE_KERNELS_H
+#define MERGE_KERNELS_H
+
+/*
+ * Internal merge kernels shared by the libmerge entry points.
+ *
+ * The kernels assume every input is already sorted and do no validation;
+ * callers check order first when they need to. The output must have room for
+ * the sum of the input lengths and must not overlap any input. Ties always go
+ * to the earlier list.
+ */
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include "sorted_merge_kway.h"
+
+typedef void (*merge2_fn)(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    int *out);
+typedef void (*merge3_fn)(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out);
+typedef bool (*merge3_check_fn)(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out);
+
+/*
+ * Instrumentation hooks (see merge_stats.h). MERGE_COUNT_CMP adds to a
+ * per-thread comparison count, and MERGE_RECORD, called by the dispatching
+ * entry points after a 2- or 3-way merge (c may be empty), records its
+ * output sources and runs and publishes the thread's count. Both are empty
+ * unless MERGE_INSTRUMENT is defined.
+ */
+#ifdef MERGE_INSTRUMENT
+/* the destructor publishes what is left when a thread exits */
+struct merge_cmp_count {
+  uint64_t n;
+  ~merge_cmp_count();
+};
+extern thread_local merge_cmp_count merge_stat_cmp;
+void
+merge_stats_record(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc);
+#define MERGE_COUNT_CMP(k) (merge_stat_cmp.n += (k))
+#define MERGE_RECORD(a, na, b, nb, c, nc) \
+  merge_stats_record(a, na, b, nb, c, nc)
+#else
+#define MERGE_COUNT_CMP(k) ((void) 0)
+#define MERGE_RECORD(a, na, b, nb, c, nc) ((void) 0)
+#endif
+
+bool
+is_sorted_list(const int *v, size_t n);
+
+/* First index i with v[i] >= x, searched exponentially from v[0]. */
+size_t
+gallop_lower(const int *v, size_t n, int x);
+
+/* First index i with v[i] > x, likewise. */
+static inline size_t
+gallop_upper(const int *v, size_t n, int x)
+{
+  return x == INT_MAX ? n : gallop_lower(v, n, x + 1);
+}
+
+/*
+ * Start of slice t when n items are cut into nt nearly equal slices, i.e.
+ * n * t / nt without overflowing for any n.
+ */
+static inline size_t
+slice_start(size_t n, unsigned t, unsigned nt)
+{
+  return n / nt * t + n % nt * t / nt;
+}
+
+/*
+ * Co-rank of two lists: the i such that the first r outputs of merging a and
+ * b are a[0..i) and b[0..r-i). Requires r <= na + nb.
+ */
+size_t
+corank2(const int *a, size_t na, const int *b, size_t nb, size_t r);
+
+/*
+ * Co-rank of k runs: fills split[0..k) so that the first r outputs of merging
+ * the runs (ties in run order) are runs[i].data[0..split[i]). Requires r to
+ * be at most the total length. Costs O(32 k log n).
+ */
+void
+corank_kway(const merge_run *runs, unsigned k, size_t r, size_t *split);
+
+/* Upper bound on the threads of the parallel entry points. */
+#define MERGE_MAX_THREADS 256
+
+/*
+ * Runs fn(ctx, t) for t = 1..nthreads-1 on new threads and for t = 0 on the
+ * caller, and returns once all are done. nthreads is 1..MERGE_MAX_THREADS.
+ */
+void
+merge_run_workers(unsigned nthreads, void (*fn)(void *ctx, unsigned t),
+    void *ctx);
+
+/*
+ * Merges the three runs, total elements in all, into out on nthreads
+ * threads: the output is cut into nthreads equal slices, and each thread
+ * finds the inputs of its slice by co-rank and merges them with
+ * merge3_kernel().
+ */
+void
+merge3_slices(const merge_run runs[3], size_t total, int *out,
+    unsigned nthreads);
+
+/* Entry points; they dispatch to the kernel picked in merge_dispatch.h. */
+void
+merge2_kernel(const int *a, size_t na, const int *b, size_t nb, int *out);
+
+void
+merge3_kernel(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out);
+
+/*
+ * 3-way merge that also validates its input and returns `false` at the first
+ * inversion found; the output is then only partially written. Dispatches
+ * like merge3_kernel(), with the branchy kernel mapped to the branchless one.
+ */
+bool
+merge3_checked(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out);
+
+/*
+ * Loser tree keys pack the value (sign bit flipped, so unsigned order matches
+ * signed order) above the run index. Comparing two keys is then a single
+ * unsigned compare that also breaks ties by run index, and an exhausted run
+ * is simply the largest key.
+ */
+#define KEY_DONE UINT64_MAX
+
+static inline uint64_t
+run_key(int v, unsigned r)
+{
+  return (uint64_t)((uint32_t)v ^ 0x80000000u) << 32 | r;
+}
+
+static inline int
+key_value(uint64_t key)
+{
+  return (int)((uint32_t)(key >> 32) ^ 0x80000000u);
+}
+
+/*
+ * Loser tree over k >= 2 leaves. Node p has children 2p and 2p + 1 and leaf i
+ * sits at k + i; tree[1..k) hold the loser key of each match. To build,
+ * store the leaf keys in tree[2k..3k) (i.e. win[k + i] with win = tree + k)
+ * and call loser_tree_build(), which returns the winner. After the winner's
+ * run advances, loser_tree_replay() plays its new key back to the root and
+ * returns the new winner.
+ */
+static inline uint64_t
+loser_tree_build(uint64_t *tree, unsigned k)
+{
+  uint64_t *win = tree + k;
+
+  MERGE_COUNT_CMP(k - 1);
+  for (unsigned p = k - 1; p; p--) {
+    uint64_t l = win[2 * p], r = win[2 * p + 1];
+    win[p] = l < r ? l : r;
+    tree[p] = l < r ? r : l;
+  }
+  return win[1];
+}
+
+static inline uint64_t
+loser_tree_replay(uint64_t *tree, unsigned k, unsigned r, uint64_t w)
+{
+  for (unsigned p = (k + r) >> 1; p; p >>= 1) {
+    MERGE_COUNT_CMP(1);
+    uint64_t l = tree[p];
+    bool s = l < w;
+    tree[p] = s ? w : l;
+    w = s ? l : w;
+  }
+  return w;
+}
+
+/*
+ * Merges k runs through a loser tree; k <= 3 goes to the kernels above.
+ * Returns `false` only if the tree could not be allocated.
+ */
+bool
+mergek_kernel(const merge_run *runs, unsigned k, int *out);
+
+/* Individual kernels */
+void merge2_branchy(const int *, size_t, const int *, size_t, int *);
+void merge3_branchy(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *);
+void merge2_branchless(const int *, size_t, const int *, size_t, int *);
+void merge3_branchless(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *);
+bool merge2_branchless_checked(const int *, size_t, const int *, size_t, int *);
+bool merge3_branchless_checked(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *);
+void merge2_gallop(const int *, size_t, const int *, size_t, int *);
+void merge3_gallop(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *);
+bool merge3_gallop_checked(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *);
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MERGE_HAVE_X86_SIMD 1
+void merge2_sse41(const int *, size_t, const int *, size_t, int *);
+void merge3_sse41(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *);
+bool merge3_sse41_checked(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *);
+void merge2_avx2(const int *, size_t, const int *, size_t, int *);
+void merge3_avx2(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *);
+bool merge3_avx2_checked(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *);
+
+/*
+ * Large-output mode (merge_stream.cpp): m3 or m3c merges blocks into a
+ * cache-resident buffer that is copied out with non-temporal stores.
+ */
+void merge3_stream(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *, merge3_fn m3);
+bool merge3_stream_checked(const int *, size_t, const int *, size_t,
+    const int *, size_t, int *, merge3_check_fn m3c);
+#endif
+
+#endif /* MERGE_KERNELS_H */
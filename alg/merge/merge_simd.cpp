@@ -0,0 +1,267 @@
+/* R. Fabbri, 2025 */
+#include "merge_kernels.h"
+#include <cstring>
+
+#ifdef MERGE_HAVE_X86_SIMD
+#include <immintrin.h>
+
+/*
+ * Vector merge kernels for x86. Each block step merges the W elements held in
+ * a register (the carry) with the next W-element block of whichever list has
+ * the smaller head, through a bitonic network of min/max and shuffles. The W
+ * smallest results are stored, the W largest become the new carry. Once
+ * either list has fewer than W elements left, the carry and both remainders
+ * are finished by the scalar three-way kernel.
+ *
+ * Under MERGE_INSTRUMENT each block step counts the compare-exchanges of its
+ * network (3 stages of 4 lanes, or 4 stages of 8) plus the head comparison.
+ *
+ * The functions are compiled for their instruction set through target
+ * attributes, so the rest of the library keeps the baseline ISA and the
+ * dispatcher only calls them after checking CPUID.
+ */
+#define SSE41 __attribute__((target("sse4.1")))
+#define AVX2 __attribute__((target("avx2")))
+
+/*
+ * Three-way merges run as two vector two-way merges: a chunk of a and b is
+ * merged into a small L1-resident buffer, which is then merged with the
+ * elements of c that come before the next a or b element. Inputs and output
+ * still go through memory once.
+ */
+#define MERGE3_CHUNK 1024
+
+/* a and b sorted on entry; on return a holds the 4 smallest, b the 4 largest */
+static inline SSE41 void
+bitonic_merge_4(__m128i &a, __m128i &b)
+{
+  __m128i r = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 1, 2, 3));
+  __m128i l = _mm_min_epi32(a, r), h = _mm_max_epi32(a, r);
+  /* l and h are bitonic: compare at distance 2, then 1 */
+  __m128i t0 = _mm_unpacklo_epi64(l, h), t1 = _mm_unpackhi_epi64(l, h);
+  __m128i m = _mm_min_epi32(t0, t1), M = _mm_max_epi32(t0, t1);
+  __m128i p = _mm_unpacklo_epi32(m, M), q = _mm_unpackhi_epi32(m, M);
+  __m128i u0 = _mm_unpacklo_epi64(p, q), u1 = _mm_unpackhi_epi64(p, q);
+  __m128i mn = _mm_min_epi32(u0, u1), mx = _mm_max_epi32(u0, u1);
+  a = _mm_unpacklo_epi32(mn, mx);
+  b = _mm_unpackhi_epi32(mn, mx);
+}
+
+/*
+ * Same network 8 wide. After the distance-4 step the low lane carries the
+ * smaller half and the high lane the larger one, so the rest of the 4-wide
+ * network runs on both lanes at once.
+ */
+static inline AVX2 void
+bitonic_merge_8(__m256i &a, __m256i &b)
+{
+  __m256i r = _mm256_permutevar8x32_epi32(b,
+      _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+  __m256i l = _mm256_min_epi32(a, r), h = _mm256_max_epi32(a, r);
+  __m256i s0 = _mm256_permute2x128_si256(l, h, 0x20);
+  __m256i s1 = _mm256_permute2x128_si256(l, h, 0x31);
+  __m256i lo = _mm256_min_epi32(s0, s1), hi = _mm256_max_epi32(s0, s1);
+  __m256i t0 = _mm256_unpacklo_epi64(lo, hi), t1 = _mm256_unpackhi_epi64(lo, hi);
+  __m256i m = _mm256_min_epi32(t0, t1), M = _mm256_max_epi32(t0, t1);
+  __m256i p = _mm256_unpacklo_epi32(m, M), q = _mm256_unpackhi_epi32(m, M);
+  __m256i u0 = _mm256_unpacklo_epi64(p, q), u1 = _mm256_unpackhi_epi64(p, q);
+  __m256i mn = _mm256_min_epi32(u0, u1), mx = _mm256_max_epi32(u0, u1);
+  __m256i x = _mm256_unpacklo_epi32(mn, mx), y = _mm256_unpackhi_epi32(mn, mx);
+  a = _mm256_permute2x128_si256(x, y, 0x20);
+  b = _mm256_permute2x128_si256(x, y, 0x31);
+}
+
+/*
+ * With CHECK set the kernels also validate the input and return `false` at
+ * the first inversion. Every adjacent pair of every list is compared exactly
+ * once: pairs inside and just before each loaded block with one extra
+ * overlapping load, pairs in the scalar tail by its own checks, and pairs at
+ * chunk seams explicitly.
+ */
+template <bool CHECK, bool (*M2)(const int *, size_t, const int *, size_t, int *)>
+static bool
+merge3_chunked(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  int buf[MERGE3_CHUNK];
+
+  while (na + nb) {
+    size_t r = na + nb < MERGE3_CHUNK ? na + nb : MERGE3_CHUNK;
+    size_t i = corank2(a, na, b, nb, r), m;
+
+    if (!M2(a, i, b, r - i, buf))
+      return false;
+    if (CHECK && ((i && i < na && a[i - 1] > a[i]) ||
+        (r - i && r - i < nb && b[r - i - 1] > b[r - i])))
+      return false;
+    a += i;
+    na -= i;
+    b += r - i;
+    nb -= r - i;
+    /* c elements strictly before the next a or b element; ties go to a, b */
+    if (!na && !nb)
+      m = nc;
+    else
+      m = gallop_lower(c, nc, !nb || (na && *a <= *b) ? *a : *b);
+    if (!M2(buf, r, c, m, out))
+      return false;
+    if (CHECK && m && m < nc && c[m - 1] > c[m])
+      return false;
+    out += r + m;
+    c += m;
+    nc -= m;
+  }
+  if (CHECK)
+    return merge2_branchless_checked(c, nc, NULL, 0, out);
+  if (nc)
+    memcpy(out, c, nc * sizeof(int));
+  return true;
+}
+
+template <bool CHECK>
+static SSE41 bool
+merge2_sse41_t(const int *a, size_t na, const int *b, size_t nb, int *out)
+{
+  const int *ea = a + na, *eb = b + nb;
+  int carry[4];
+
+  if (na < 4 || nb < 4) {
+    if (CHECK)
+      return merge2_branchless_checked(a, na, b, nb, out);
+    merge2_branchless(a, na, b, nb, out);
+    return true;
+  }
+  if (CHECK && (!is_sorted_list(a, 4) || !is_sorted_list(b, 4)))
+    return false;
+  __m128i va = _mm_loadu_si128((const __m128i *) a);
+  __m128i vb = _mm_loadu_si128((const __m128i *) b);
+  a += 4;
+  b += 4;
+  for (;;) {
+    MERGE_COUNT_CMP(12 + 1);
+    bitonic_merge_4(va, vb);
+    _mm_storeu_si128((__m128i *) out, va);
+    out += 4;
+    if (ea - a < 4 || eb - b < 4)
+      break;
+    bool ta = *a <= *b;
+    const int *p = ta ? a : b;
+    va = _mm_loadu_si128((const __m128i *) p);
+    if (CHECK) {
+      __m128i bad = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *) (p - 1)), va);
+      if (!_mm_testz_si128(bad, bad))
+        return false;
+    }
+    a += ta ? 4 : 0;
+    b += ta ? 0 : 4;
+  }
+  _mm_storeu_si128((__m128i *) carry, vb);
+  if (CHECK)
+    return (a == ea || a[-1] <= *a) && (b == eb || b[-1] <= *b) &&
+        merge3_branchless_checked(carry, 4, a, ea - a, b, eb - b, out);
+  merge3_branchless(carry, 4, a, ea - a, b, eb - b, out);
+  return true;
+}
+
+template <bool CHECK>
+static AVX2 bool
+merge2_avx2_t(const int *a, size_t na, const int *b, size_t nb, int *out)
+{
+  const int *ea = a + na, *eb = b + nb;
+  int carry[8];
+
+  if (na < 8 || nb < 8) {
+    if (CHECK)
+      return merge2_branchless_checked(a, na, b, nb, out);
+    merge2_branchless(a, na, b, nb, out);
+    return true;
+  }
+  if (CHECK && (!is_sorted_list(a, 8) || !is_sorted_list(b, 8)))
+    return false;
+  __m256i va = _mm256_loadu_si256((const __m256i *) a);
+  __m256i vb = _mm256_loadu_si256((const __m256i *) b);
+  a += 8;
+  b += 8;
+  for (;;) {
+    MERGE_COUNT_CMP(32 + 1);
+    bitonic_merge_8(va, vb);
+    _mm256_storeu_si256((__m256i *) out, va);
+    out += 8;
+    if (ea - a < 8 || eb - b < 8)
+      break;
+    bool ta = *a <= *b;
+    const int *p = ta ? a : b;
+    va = _mm256_loadu_si256((const __m256i *) p);
+    if (CHECK) {
+      __m256i bad = _mm256_cmpgt_epi32(
+          _mm256_loadu_si256((const __m256i *) (p - 1)), va);
+      if (!_mm256_testz_si256(bad, bad))
+        return false;
+    }
+    a += ta ? 8 : 0;
+    b += ta ? 0 : 8;
+  }
+  _mm256_storeu_si256((__m256i *) carry, vb);
+  if (CHECK)
+    return (a == ea || a[-1] <= *a) && (b == eb || b[-1] <= *b) &&
+        merge3_branchless_checked(carry, 8, a, ea - a, b, eb - b, out);
+  merge3_branchless(carry, 8, a, ea - a, b, eb - b, out);
+  return true;
+}
+
+SSE41 void
+merge2_sse41(const int *a, size_t na, const int *b, size_t nb, int *out)
+{
+  merge2_sse41_t<false>(a, na, b, nb, out);
+}
+
+SSE41 void
+merge3_sse41(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  merge3_chunked<false, merge2_sse41_t<false> >(a, na, b, nb, c, nc, out);
+}
+
+SSE41 bool
+merge3_sse41_checked(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  return merge3_chunked<true, merge2_sse41_t<true> >(a, na, b, nb, c, nc, out);
+}
+
+AVX2 void
+merge2_avx2(const int *a, size_t na, const int *b, size_t nb, int *out)
+{
+  merge2_avx2_t<false>(a, na, b, nb, out);
+}
+
+AVX2 void
+merge3_avx2(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  merge3_chunked<false, merge2_avx2_t<false> >(a, na, b, nb, c, nc, out);
+}
+
+AVX2 bool
+merge3_avx2_checked(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out)
+{
+  return merge3_chunked<true, merge2_avx2_t<true> >(a, na, b, nb, c, nc, out);
+}
+
+#endif /* MERGE_HAVE_X86_SIMD */
@@ -0,0 +1,114 @@
+/* R. Fabbri, 2025 */
+#include "merge_sort.h"
+#include "merge_kernels.h"
+#include <cstdlib>
+#include <thread>
+
+#define MSORT_BASE 24
+#define MSORT_MIN_PER_THREAD (1 << 16)
+
+/*
+ * Insertion sort of src[0, n) into dst; src == dst sorts in place. Each
+ * element is read from src before dst[i] is written, so that case is safe.
+ */
+static void
+insertion_sort(const int *src, int *dst, size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    int x = src[i];
+    size_t j = i;
+    while (j && dst[j - 1] > x) {
+      dst[j] = dst[j - 1];
+      j--;
+    }
+    dst[j] = x;
+  }
+}
+
+/*
+ * Sorts a[0, n). The result lands in b if into_b, otherwise back in a; the
+ * other array is scratch. The thirds are sorted into the opposite array and
+ * merged back, so the two arrays swap roles at each level.
+ */
+static void
+sort_serial(int *a, int *b, size_t n, bool into_b)
+{
+  if (n <= MSORT_BASE) {
+    insertion_sort(a, into_b ? b : a, n);
+    return;
+  }
+  size_t n0 = n / 3, n1 = (n - n0) / 2, n2 = n - n0 - n1;
+  sort_serial(a, b, n0, !into_b);
+  sort_serial(a + n0, b + n0, n1, !into_b);
+  sort_serial(a + n0 + n1, b + n0 + n1, n2, !into_b);
+
+  const int *src = into_b ? a : b;
+  merge3_kernel(src, n0, src + n0, n1, src + n0 + n1, n2, into_b ? b : a);
+}
+
+/*
+ * sort_serial() on nthreads threads: each third gets a share of the threads,
+ * and the merge is cut into nthreads output slices by co-rank. The shares
+ * add up to nthreads, counting the caller, which sorts third 0. A third with
+ * no share, only possible with 2 threads, is sorted on the caller after
+ * third 0.
+ */
+static void
+sort_parallel(int *a, int *b, size_t n, bool into_b, unsigned nthreads)
+{
+  if (nthreads <= 1) {
+    sort_serial(a, b, n, into_b);
+    return;
+  }
+  size_t n0 = n / 3, n1 = (n - n0) / 2, n2 = n - n0 - n1;
+  size_t off[3] = { 0, n0, n0 + n1 }, len[3] = { n0, n1, n2 };
+  unsigned share[3];
+  std::thread workers[3];
+
+  /* the larger shares go first, so third 0 always has one */
+  for (unsigned i = 0; i < 3; i++)
+    share[i] = nthreads * (3 - i) / 3 - nthreads * (2 - i) / 3;
+  for (unsigned i = 1; i < 3; i++)
+    if (share[i])
+      workers[i] = std::thread(sort_parallel, a + off[i], b + off[i],
+          len[i], !into_b, share[i]);
+  for (unsigned i = 0; i < 3; i++)
+    if (!i || !share[i])
+      sort_parallel(a + off[i], b + off[i], len[i], !into_b,
+          share[i] ? share[i] : 1);
+  for (unsigned i = 1; i < 3; i++)
+    if (share[i])
+      workers[i].join();
+
+  const int *src = into_b ? a : b;
+  merge_run runs[3] = {
+    { src, n0 }, { src + n0, n1 }, { src + n0 + n1, n2 } };
+  merge3_slices(runs, n, into_b ? b : a, nthreads);
+}
+
+void
+merge_sort_buf(int *v, size_t n, int *tmp, unsigned nthreads)
+{
+  if (!nthreads)
+    nthreads = std::thread::hardware_concurrency();
+  if (nthreads > n / MSORT_MIN_PER_THREAD)
+    nthreads = n / MSORT_MIN_PER_THREAD;
+  if (nthreads > MERGE_MAX_THREADS)
+    nthreads = MERGE_MAX_THREADS;
+  sort_parallel(v, tmp, n, false, nthreads);
+}
+
+bool
+merge_sort(int *v, size_t n, unsigned nthreads)
+{
+  if (n <= MSORT_BASE) {
+    insertion_sort(v, v, n);
+    return true;
+  }
+  int *tmp = (int *) malloc(n * sizeof(int));
+  if (!tmp)
+    return false;
+  merge_sort_buf(v, n, tmp, nthreads);
+  free(tmp);
+  return true;
+}
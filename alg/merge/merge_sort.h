@@ -0,0 +1,38 @@
+/* R. Fabbri, 2025 */
+#ifndef MERGE_SORT_H
+#define MERGE_SORT_H
+
+#include <cstddef>
+
+/*
+ * Sorts n integers in increasing order with a 3-way mergesort.
+ *
+ * The array is split into thirds down to blocks of at most 24 elements,
+ * which are insertion sorted. Each level then merges three sorted thirds
+ * with the same kernel as sorted_merge_3way(), moving between the array and
+ * a scratch buffer of n ints so no level copies. Merging three runs at a time
+ * makes log3(n) passes over memory instead of log2(n).
+ *
+ * With more than one thread, the three thirds at the top levels are sorted
+ * on separate threads, and their merges are split by co-rank so every thread
+ * writes its own slice. Arrays with fewer than about 64K elements per thread
+ * use fewer threads.
+ *
+ * @param v         Array to sort in place.
+ * @param n         Number of elements.
+ * @param nthreads  Number of threads, including the caller; 0 uses the
+ *                  hardware concurrency.
+ * @return          `false` if the scratch buffer could not be allocated
+ *                  (v is left untouched), `true` otherwise.
+ */
+bool
+merge_sort(int *v, size_t n, unsigned nthreads);
+
+/*
+ * merge_sort() with a scratch buffer of n ints supplied by the caller, for
+ * repeated sorts of similar size. tmp must not overlap v.
+ */
+void
+merge_sort_buf(int *v, size_t n, int *tmp, unsigned nthreads);
+
+#endif /* MERGE_SORT_H */
@@ -0,0 +1,116 @@
+/* R. Fabbri, 2025 */
+#include "merge_stats.h"
+#include "merge_kernels.h"
+#include <atomic>
+#include <cstring>
+
+#ifdef MERGE_INSTRUMENT
+static std::atomic<uint64_t> st_calls, st_cmp, st_out[3], st_runs;
+static std::atomic<uint64_t> st_run_len[MERGE_STATS_RUN_BUCKETS];
+
+thread_local merge_cmp_count merge_stat_cmp;
+
+merge_cmp_count::~merge_cmp_count()
+{
+  st_cmp.fetch_add(n, std::memory_order_relaxed);
+}
+
+static inline unsigned
+run_bucket(size_t n)
+{
+  unsigned b = 63 - __builtin_clzll(n);
+  return b < MERGE_STATS_RUN_BUCKETS ? b : MERGE_STATS_RUN_BUCKETS - 1;
+}
+
+/*
+ * Replays the merge one run at a time: the list with the smallest head
+ * (ties to the earlier list) keeps winning up to the first element that
+ * another head precedes, found by galloping as in the gallop kernels. The
+ * searches here are not counted as comparisons.
+ */
+void
+merge_stats_record(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc)
+{
+  const int *p[3] = { a, b, c };
+  size_t n[3] = { na, nb, nc };
+  uint64_t cmp = merge_stat_cmp.n, runs = 0;
+  uint64_t hist[MERGE_STATS_RUN_BUCKETS] = { 0 };
+
+  for (;;) {
+    unsigned s = 3;
+    for (unsigned j = 0; j < 3; j++)
+      if (n[j] && (s == 3 || *p[j] < *p[s]))
+        s = j;
+    if (s == 3)
+      break;
+    size_t len = n[s];
+    for (unsigned j = 0; j < 3; j++) {
+      if (j == s || !n[j])
+        continue;
+      size_t m = j < s ? gallop_lower(p[s], n[s], *p[j]) :
+          gallop_upper(p[s], n[s], *p[j]);
+      len = m < len ? m : len;
+    }
+    p[s] += len;
+    n[s] -= len;
+    runs++;
+    hist[run_bucket(len)]++;
+  }
+
+  st_calls.fetch_add(1, std::memory_order_relaxed);
+  st_cmp.fetch_add(cmp, std::memory_order_relaxed);
+  merge_stat_cmp.n = 0;
+  st_out[0].fetch_add(na, std::memory_order_relaxed);
+  st_out[1].fetch_add(nb, std::memory_order_relaxed);
+  st_out[2].fetch_add(nc, std::memory_order_relaxed);
+  st_runs.fetch_add(runs, std::memory_order_relaxed);
+  for (unsigned i = 0; i < MERGE_STATS_RUN_BUCKETS; i++)
+    if (hist[i])
+      st_run_len[i].fetch_add(hist[i], std::memory_order_relaxed);
+}
+#endif
+
+bool
+merge_stats_enabled()
+{
+#ifdef MERGE_INSTRUMENT
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+merge_stats_reset()
+{
+#ifdef MERGE_INSTRUMENT
+  merge_stat_cmp.n = 0;
+  st_calls = 0;
+  st_cmp = 0;
+  st_runs = 0;
+  for (unsigned i = 0; i < 3; i++)
+    st_out[i] = 0;
+  for (unsigned i = 0; i < MERGE_STATS_RUN_BUCKETS; i++)
+    st_run_len[i] = 0;
+#endif
+}
+
+void
+merge_stats_get(merge_stats *s)
+{
+  memset(s, 0, sizeof(*s));
+#ifdef MERGE_INSTRUMENT
+  st_cmp.fetch_add(merge_stat_cmp.n, std::memory_order_relaxed);
+  merge_stat_cmp.n = 0;
+  s->calls = st_calls;
+  s->comparisons = st_cmp;
+  s->runs = st_runs;
+  for (unsigned i = 0; i < 3; i++)
+    s->outputs[i] = st_out[i];
+  for (unsigned i = 0; i < MERGE_STATS_RUN_BUCKETS; i++)
+    s->run_len[i] = st_run_len[i];
+#endif
+}
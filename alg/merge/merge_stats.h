@@ -0,0 +1,48 @@
+/* R. Fabbri, 2025 */
+#ifndef MERGE_STATS_H
+#define MERGE_STATS_H
+
+#include <cstdint>
+
+/*
+ * Merge instrumentation, to find out why one input shape merges slower than
+ * another. Configuring with -DLIBMERGE_INSTRUMENT=ON builds libmerge with
+ * MERGE_INSTRUMENT defined, and every merge on every thread then adds to the
+ * counters below. In a normal build the hooks expand to nothing, so the
+ * kernels are the same code as without them, and merge_stats_get() reports
+ * zeros.
+ *
+ * Comparisons are those that order keys: in the merge loops, the galloping
+ * and co-rank searches and the loser tree. A vector compare-exchange (a
+ * min and a max) counts one per lane. Sources and runs are recorded for
+ * each 2- and 3-way kernel call, so a run that spans two calls (two slices
+ * of a parallel merge, say) counts as two.
+ */
+#define MERGE_STATS_RUN_BUCKETS 32
+
+struct merge_stats {
+  uint64_t calls;         /* 2- and 3-way kernel calls */
+  uint64_t comparisons;
+  uint64_t outputs[3];    /* elements taken from the first, second and
+                             third list of each call */
+  uint64_t runs;          /* maximal stretches of output from one list */
+  uint64_t run_len[MERGE_STATS_RUN_BUCKETS];
+                          /* runs of length [2^i, 2^(i+1)); the last bucket
+                             also takes everything longer */
+};
+
+/* @return  `true` if libmerge was built with MERGE_INSTRUMENT. */
+bool
+merge_stats_enabled();
+
+void
+merge_stats_reset();
+
+/*
+ * Totals since the last reset. Comparisons made by other threads are
+ * included once their kernel call has returned or the thread has exited.
+ */
+void
+merge_stats_get(merge_stats *s);
+
+#endif /* MERGE_STATS_H */
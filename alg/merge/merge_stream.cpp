@@ -0,0 +1,152 @@
+/* R. Fabbri, 2025 */
+#include "merge_kernels.h"
+#include <climits>
+#include <cstring>
+
+#ifdef MERGE_HAVE_X86_SIMD
+#include <immintrin.h>
+
+/*
+ * Large-output 3-way merge. Each step takes a window of STREAM_WINDOW
+ * elements from every list and bounds it by the smallest last value among
+ * full windows: every element up to that bound, in all three lists, lies
+ * inside the windows, so one binary search per list gives a block that can be
+ * merged on its own. The regular kernel merges the block into a small
+ * cache-resident buffer, and whole cache lines of the buffer go to memory with
+ * non-temporal stores, which neither read the lines for ownership nor evict
+ * the inputs. The partial line left over is carried to the next block. While
+ * copying, the next block's input lines are prefetched, one per output line.
+ */
+#define STREAM_WINDOW (1 << 11)
+#define LINE_INTS 16
+#define SSE2 __attribute__((target("sse2")))
+
+/* streams n ints, n a multiple of LINE_INTS, to a line-aligned dst */
+static SSE2 void
+stream_copy(int *dst, const int *src, size_t n, const int *const *next,
+    const size_t *next_len)
+{
+  size_t line = 0;
+
+  for (size_t i = 0; i < n; i += LINE_INTS, line++) {
+    const __m128i *s = (const __m128i *) (src + i);
+    __m128i *d = (__m128i *) (dst + i);
+    _mm_stream_si128(d, _mm_load_si128(s));
+    _mm_stream_si128(d + 1, _mm_load_si128(s + 1));
+    _mm_stream_si128(d + 2, _mm_load_si128(s + 2));
+    _mm_stream_si128(d + 3, _mm_load_si128(s + 3));
+    size_t off = line / 3 * LINE_INTS;
+    if (off < next_len[line % 3])
+      _mm_prefetch((const char *) (next[line % 3] + off), _MM_HINT_T0);
+  }
+}
+
+/*
+ * Runs m3 or m3c (whichever is not NULL) block by block. Returns `false` if
+ * the checked kernel finds an inversion, including across block seams.
+ */
+static bool
+merge3_stream_blocks(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out, merge3_fn m3, merge3_check_fn m3c)
+{
+  alignas(64) int buf[3 * STREAM_WINDOW + LINE_INTS];
+  const int *p[3] = { a, b, c };
+  size_t n[3] = { na, nb, nc }, s[3], carry = 0;
+  size_t head = (64 - (uintptr_t) out % 64) % 64 / sizeof(int);
+  bool ok = true, first = true;
+  int last = 0;
+
+  /* up to the first line boundary of out, written in place */
+  if (head && head < na + nb + nc) {
+    merge_run w[3] = { { a, na }, { b, nb }, { c, nc } };
+    corank_kway(w, 3, head, s);
+    if (s[0] + s[1] + s[2] == head) {
+      if (m3c) {
+        ok = m3c(a, s[0], b, s[1], c, s[2], out);
+        last = out[head - 1];
+        first = false;
+      } else {
+        m3(a, s[0], b, s[1], c, s[2], out);
+      }
+      for (int i = 0; i < 3; i++) {
+        p[i] += s[i];
+        n[i] -= s[i];
+      }
+      out += head;
+    }
+  }
+
+  while (ok && ((uintptr_t) out % 64 == 0)) {
+    int bound = INT_MAX;
+    bool full = false;
+    for (int i = 0; i < 3; i++)
+      if (n[i] >= STREAM_WINDOW && p[i][STREAM_WINDOW - 1] <= bound) {
+        bound = p[i][STREAM_WINDOW - 1];
+        full = true;
+      }
+    size_t r = 0;
+    for (int i = 0; i < 3; i++) {
+      size_t w = n[i] < STREAM_WINDOW ? n[i] : STREAM_WINDOW;
+      s[i] = full ? gallop_upper(p[i], w, bound) : w;
+      r += s[i];
+    }
+    if (!r)
+      break;
+
+    int *dst = buf + carry;
+    if (m3c) {
+      ok = m3c(p[0], s[0], p[1], s[1], p[2], s[2], dst) &&
+          (first || dst[0] >= last);
+      last = dst[r - 1];
+      first = false;
+    } else {
+      m3(p[0], s[0], p[1], s[1], p[2], s[2], dst);
+    }
+    for (int i = 0; i < 3; i++) {
+      p[i] += s[i];
+      n[i] -= s[i];
+    }
+    size_t total = carry + r, whole = total - total % LINE_INTS;
+    stream_copy(out, buf, whole, p, n);
+    out += whole;
+    carry = total - whole;
+    memmove(buf, buf + whole, carry * sizeof(int));
+  }
+  memcpy(out, buf, carry * sizeof(int));
+  out += carry;
+  _mm_sfence();
+
+  /* only unsorted input, or an output too short to reach a line boundary */
+  if (ok && n[0] + n[1] + n[2]) {
+    if (m3c)
+      return m3c(p[0], n[0], p[1], n[1], p[2], n[2], out) &&
+          (first || out[0] >= last);
+    m3(p[0], n[0], p[1], n[1], p[2], n[2], out);
+  }
+  return ok;
+}
+
+void
+merge3_stream(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out, merge3_fn m3)
+{
+  merge3_stream_blocks(a, na, b, nb, c, nc, out, m3, NULL);
+}
+
+bool
+merge3_stream_checked(
+    const int *a, size_t na,
+    const int *b, size_t nb,
+    const int *c, size_t nc,
+    int *out, merge3_check_fn m3c)
+{
+  return merge3_stream_blocks(a, na, b, nb, c, nc, out, NULL, m3c);
+}
+
+#endif /* MERGE_HAVE_X86_SIMD */
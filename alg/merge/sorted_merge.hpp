@@ -0,0 +1,222 @@
+/* R. Fabbri, 2025 */
+#ifndef SORTED_MERGE_HPP
+#define SORTED_MERGE_HPP
+
+/*
+ * Typed N-way merge, header only.
+ *
+ * sorted_merge<T, Compare, N>() merges N sorted spans of any trivially
+ * copyable T (int64_t, uint32_t, float, double, plain structs) ordered by a
+ * comparator type that is inlined at compile time. Lengths are size_t.
+ *
+ * The merge is always stable: equal elements come out in input order (all of
+ * span 0, then span 1, ...) and keep their order within each span. Rows that
+ * share a key therefore keep their source order, and stability costs nothing
+ * since it is just the tie-break of every comparison. N = 2 and 3 run
+ * templated copies of the branchless loops of libmerge, defined here so they
+ * need no link to it, and larger N uses a loser tree sized at compile time.
+ *
+ * Example, (key, row id) records ordered by key:
+ *
+ *   struct row { int64_t key; uint32_t id; };
+ *   struct row_key { int64_t operator()(const row &r) const { return r.key; } };
+ *
+ *   merge_span<row> in[3] = { { a, na }, { b, nb }, { c, nc } };
+ *   sorted_merge<row, merge_by_key<row_key> >(in, out);
+ *
+ * Comparators must be strict weak orders; with merge_less, floating point
+ * inputs must not contain NaN.
+ */
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+template <class T>
+struct merge_span {
+  const T *data;
+  size_t n;
+};
+
+/* operator< */
+struct merge_less {
+  template <class T>
+  bool operator()(const T &x, const T &y) const { return x < y; }
+};
+
+/* orders records by KeyOf()(record), compared with Less */
+template <class KeyOf, class Less = merge_less>
+struct merge_by_key {
+  template <class T>
+  bool operator()(const T &x, const T &y) const
+  {
+    return Less()(KeyOf()(x), KeyOf()(y));
+  }
+};
+
+namespace sorted_merge_detail {
+
+template <class T>
+inline T *
+copy(const T *v, size_t n, T *out)
+{
+  if (n)
+    memcpy((void *) out, (const void *) v, n * sizeof(T));
+  return out + n;
+}
+
+template <class T, class Compare>
+inline bool
+is_sorted(const T *v, size_t n, Compare cmp)
+{
+  for (size_t i = 1; i < n; i++)
+    if (cmp(v[i], v[i - 1]))
+      return false;
+  return true;
+}
+
+/* same structure as merge2_branchless(): no bounds checks inside a run */
+template <class T, class Compare>
+inline T *
+merge2(const T *a, size_t na, const T *b, size_t nb, T *out, Compare cmp)
+{
+  const T *ea = a + na, *eb = b + nb;
+
+  for (;;) {
+    size_t m = ea - a < eb - b ? ea - a : eb - b;
+    if (!m)
+      break;
+    do {
+      bool tb = cmp(*b, *a);
+      *out++ = tb ? *b : *a;
+      a += !tb;
+      b += tb;
+    } while (--m);
+  }
+  out = copy(a, ea - a, out);
+  return copy(b, eb - b, out);
+}
+
+template <class T, class Compare>
+inline T *
+merge3(const T *a, size_t na, const T *b, size_t nb, const T *c, size_t nc,
+    T *out, Compare cmp)
+{
+  const T *ea = a + na, *eb = b + nb, *ec = c + nc;
+
+  for (;;) {
+    size_t m = ea - a < eb - b ? ea - a : eb - b;
+    if ((size_t) (ec - c) < m)
+      m = ec - c;
+    if (!m)
+      break;
+    do {
+      bool tc = cmp(*c, *b);
+      const T *bc = tc ? c : b;
+      bool ta = !cmp(*bc, *a);
+      *out++ = ta ? *a : *bc;
+      a += ta;
+      b += !ta & !tc;
+      c += !ta & tc;
+    } while (--m);
+  }
+  if (a == ea)
+    return merge2(b, eb - b, c, ec - c, out, cmp);
+  if (b == eb)
+    return merge2(a, ea - a, c, ec - c, out, cmp);
+  return merge2(a, ea - a, b, eb - b, out, cmp);
+}
+
+/*
+ * Loser tree over run indices: node p has children 2p and 2p + 1, leaf i is
+ * at N + i. Exhausted runs lose every match, and ties go to the lower index.
+ */
+template <class T, class Compare, size_t N>
+inline void
+mergek(const merge_span<T> (&in)[N], T *out, Compare cmp)
+{
+  const T *cur[N], *end[N];
+  unsigned tree[N], win[2 * N];
+  size_t total = 0;
+
+  for (size_t i = 0; i < N; i++) {
+    cur[i] = in[i].data;
+    end[i] = in[i].data + in[i].n;
+    total += in[i].n;
+    win[N + i] = i;
+  }
+  /* does run i beat run j? */
+  auto beats = [&](unsigned i, unsigned j) {
+    if (cur[j] == end[j])
+      return true;
+    if (cur[i] == end[i])
+      return false;
+    return cmp(*cur[i], *cur[j]) || (i < j && !cmp(*cur[j], *cur[i]));
+  };
+  for (size_t p = N - 1; p; p--) {
+    unsigned l = win[2 * p], r = win[2 * p + 1];
+    bool lw = beats(l, r);
+    win[p] = lw ? l : r;
+    tree[p] = lw ? r : l;
+  }
+
+  unsigned w = win[1];
+  for (size_t t = 0; t < total; t++) {
+    out[t] = *cur[w]++;
+    for (size_t p = (N + w) >> 1; p; p >>= 1) {
+      unsigned l = tree[p];
+      if (beats(l, w)) {
+        tree[p] = w;
+        w = l;
+      }
+    }
+  }
+}
+
+} /* namespace sorted_merge_detail */
+
+/*
+ * Merges N sorted spans into out without checking order.
+ *
+ * @param in   The N input spans, any of which may be empty.
+ * @param out  Output with room for the sum of the span lengths; it must not
+ *             overlap any input.
+ * @param cmp  Comparator instance, default constructed if omitted.
+ */
+template <class T, class Compare = merge_less, size_t N>
+inline void
+sorted_merge_trusted(const merge_span<T> (&in)[N], T *out,
+    Compare cmp = Compare())
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+      "sorted_merge needs trivially copyable elements");
+  namespace d = sorted_merge_detail;
+
+  if constexpr (N == 1)
+    d::copy(in[0].data, in[0].n, out);
+  else if constexpr (N == 2)
+    d::merge2(in[0].data, in[0].n, in[1].data, in[1].n, out, cmp);
+  else if constexpr (N == 3)
+    d::merge3(in[0].data, in[0].n, in[1].data, in[1].n,
+        in[2].data, in[2].n, out, cmp);
+  else
+    d::mergek(in, out, cmp);
+}
+
+/*
+ * Merges N sorted spans into out.
+ *
+ * @return  `true` if all spans were sorted under cmp and the merge was done,
+ *          `false` otherwise (nothing is written in that case).
+ */
+template <class T, class Compare = merge_less, size_t N>
+inline bool
+sorted_merge(const merge_span<T> (&in)[N], T *out, Compare cmp = Compare())
+{
+  for (size_t i = 0; i < N; i++)
+    if (!sorted_merge_detail::is_sorted(in[i].data, in[i].n, cmp))
+      return false;
+  sorted_merge_trusted<T, Compare, N>(in, out, cmp);
+  return true;
+}
+
+#endif /* SORTED_MERGE_HPP */
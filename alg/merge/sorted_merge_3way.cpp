@@ -1,19 +1,7 @@
 /* R. Fabbri, 2024 */
 #include "sorted_merge_3way.h"
-#include <climits>
-
-static bool is_sorted(const int *arr, int n) {
-  if (n <= 1) {
-    return true;
-  }
-  
-  for(int i = 1; i < n; i++) {
-    if(arr[i] < arr[i - 1]) {
-      return false;
-    }
-  }
-  return true;
-}
+#include "merge_kernels.h"
+#include <cstdint>
 
 bool
 sorted_merge_3way(
@@ -22,32 +10,91 @@ sorted_merge_3way(
     const int *list_c, int nc,
     int *list_abc)
 {
+  if (na < 0 || nb < 0 || nc < 0)
+    return false;
+  return sorted_merge_3way64(list_a, na, list_b, nb, list_c, nc, list_abc);
+}
+
+bool
+sorted_merge_3way64(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc)
+{
+  const size_t max = SIZE_MAX / sizeof(int);
 
-  if(!is_sorted(list_a, na) || !is_sorted(list_b, nb) || !is_sorted(list_c, nc)) {
+  if (na > max || nb > max - na || nc > max - na - nb)
     return false;
-  }
 
-  int ia = 0, ib = 0, ic = 0;
-  int idx = 0;
+  if (!is_sorted_list(list_a, na) || !is_sorted_list(list_b, nb) ||
+      !is_sorted_list(list_c, nc))
+    return false;
 
-  while(ia < na || ib < nb || ic < nc) {
-    int va = (ia < na) ? list_a[ia] : INT_MAX;
-    int vb = (ib < nb) ? list_b[ib] : INT_MAX;
-    int vc = (ic < nc) ? list_c[ic] : INT_MAX;
+  merge3_kernel(list_a, na, list_b, nb, list_c, nc, list_abc);
+  return true;
+}
 
-    if(va <= vb && va <= vc) {
-      list_abc[idx++] = va;
-      ia++;
-    }
-    else if(vb <= va && vb <= vc) {
-      list_abc[idx++] = vb;
-      ib++;
-    }
-    else {
-      list_abc[idx++] = vc;
-      ic++;
+bool
+sorted_merge_3way_fused(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc)
+{
+  return merge3_checked(list_a, na, list_b, nb, list_c, nc, list_abc);
+}
+
+void
+sorted_merge_3way_trusted(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc)
+{
+  merge3_kernel(list_a, na, list_b, nb, list_c, nc, list_abc);
+}
+
+size_t
+sorted_merge_topk(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    size_t k, int *list_abc)
+{
+  merge_run runs[3] = { { list_a, na }, { list_b, nb }, { list_c, nc } };
+  size_t split[3];
+
+  if (k > na + nb + nc)
+    k = na + nb + nc;
+  corank_kway(runs, 3, k, split);
+  merge3_kernel(list_a, split[0], list_b, split[1], list_c, split[2],
+      list_abc);
+  return k;
+}
+
+bool
+sorted_merge_rank(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    size_t r, int *value)
+{
+  merge_run runs[3] = { { list_a, na }, { list_b, nb }, { list_c, nc } };
+  size_t split[3];
+  bool any = false;
+  int v = 0;
+
+  if (r >= na + nb + nc)
+    return false;
+  /* the element of rank r is the largest of the first r + 1 */
+  corank_kway(runs, 3, r + 1, split);
+  for (int i = 0; i < 3; i++) {
+    if (split[i] && (!any || runs[i].data[split[i] - 1] > v)) {
+      v = runs[i].data[split[i] - 1];
+      any = true;
     }
   }
-
+  *value = v;
   return true;
 }
@@ -2,6 +2,8 @@
 #ifndef SORTED_MERGE_3WAY_H
 #define SORTED_MERGE_3WAY_H
 
+#include <cstddef>
+
 /*
  * Merges three sorted integer lists (lista_a, lista_b, lista_c) into a
  * single sorted list (lista_abc).
@@ -16,6 +18,10 @@
  *                  to hold all elements from the input lists (na+nb+nc).
  * @return          `true` if the merge was successful and all input lists
  *                  were sorted, `false` otherwise.
+ *
+ * The int lengths limit this call to 2^31 - 1 elements per list, and negative
+ * lengths return `false`. It is kept for compatibility and forwards to
+ * sorted_merge_3way64().
  */
 bool
 sorted_merge_3way(
@@ -24,4 +30,101 @@ sorted_merge_3way(
     const int *list_c, int nc,
     int *list_abc);
 
+/*
+ * sorted_merge_3way() with size_t lengths, for lists and outputs of any size
+ * that fits in memory. All indexing inside the kernels is done in size_t.
+ * Returns `false` without reading the lists if na+nb+nc ints would not fit in
+ * the address space.
+ */
+bool
+sorted_merge_3way64(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc);
+
+/*
+ * sorted_merge_3way() with the sortedness check fused into the merge.
+ *
+ * Instead of reading every input once more up front, each output is compared
+ * with the previous one, which fails exactly when some input list is out of
+ * order. The call returns `false` at the first such inversion; list_abc is
+ * then partially written and its contents are unspecified. The vector
+ * kernels check each loaded block against the element before it instead.
+ *
+ * The parameters and the return value are as in sorted_merge_3way().
+ */
+bool
+sorted_merge_3way_fused(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc);
+
+/*
+ * sorted_merge_3way() without any check, for callers that already guarantee
+ * sorted input. Unsorted input gives an unspecified permutation in list_abc.
+ */
+void
+sorted_merge_3way_trusted(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc);
+
+/*
+ * Multithreaded sorted_merge_3way() for large inputs.
+ *
+ * The output is cut into nthreads equal segments. Each worker finds where its
+ * segment starts in every list by co-rank binary search and merges it on its
+ * own, so nothing is shared inside the merge loop. The sortedness check is
+ * split the same way. Inputs with fewer than about 64K elements per thread
+ * use fewer threads, down to the calling thread alone.
+ *
+ * @param nthreads  Number of threads, including the caller; 0 uses the
+ *                  hardware concurrency.
+ * The other parameters and the return value are as in sorted_merge_3way().
+ */
+bool
+sorted_merge_3way_parallel(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc, unsigned nthreads);
+
+/*
+ * The first k outputs of sorted_merge_3way() only, in O(k) output space.
+ *
+ * A binary search over the 32-bit value range finds how many of the k
+ * smallest elements come from each list; each of its 32 steps binary-searches
+ * all three lists, about 32 * 3 * log2 n comparisons in all. Only those
+ * prefixes are then merged, in O(k). Inputs must be sorted; they are not
+ * checked, since that alone would read all of them.
+ *
+ * @param k         Number of outputs wanted.
+ * @param list_abc  Output with room for min(k, na+nb+nc) ints.
+ * @return          The number of ints written, min(k, na+nb+nc).
+ * The other parameters are as in sorted_merge_3way().
+ */
+size_t
+sorted_merge_topk(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    size_t k, int *list_abc);
+
+/*
+ * The element at position r (from 0) of the merge of the three sorted lists,
+ * found by the same co-rank search without writing any output.
+ *
+ * @param value  Set to the element of rank r.
+ * @return       `false` if r >= na+nb+nc; value is then untouched.
+ */
+bool
+sorted_merge_rank(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    size_t r, int *value);
+
 #endif /* SORTED_MERGE_3WAY_H */
@@ -0,0 +1,133 @@
+/* R. Fabbri, 2025 */
+#include "sorted_merge_batch.h"
+#include "merge_kernels.h"
+#include <climits>
+#include <cstring>
+#include <thread>
+
+#define BATCH_NET 16
+#define BATCH_SMALL 64
+#define BATCH_MAX_THREADS 256
+#define BATCH_MIN_PER_THREAD 4096
+
+#define CE(i, j) do {                              \
+    int x_ = v[i], y_ = v[j];                      \
+    v[i] = x_ < y_ ? x_ : y_;                      \
+    v[j] = x_ < y_ ? y_ : x_;                      \
+  } while (0)
+
+/*
+ * Batcher's odd-even merge sort on 16 ints, in 10 layers of independent
+ * compare-exchanges. The unused tail of v is padded with INT_MAX.
+ */
+static inline void
+sort16(int *v)
+{
+  CE(0, 1); CE(2, 3); CE(4, 5); CE(6, 7);
+  CE(8, 9); CE(10, 11); CE(12, 13); CE(14, 15);
+  CE(0, 2); CE(1, 3); CE(4, 6); CE(5, 7);
+  CE(8, 10); CE(9, 11); CE(12, 14); CE(13, 15);
+  CE(1, 2); CE(5, 6); CE(9, 10); CE(13, 14);
+  CE(0, 4); CE(3, 7); CE(8, 12); CE(11, 15);
+  CE(1, 5); CE(2, 6); CE(9, 13); CE(10, 14); CE(0, 8); CE(7, 15);
+  CE(2, 4); CE(3, 5); CE(10, 12); CE(11, 13);
+  CE(1, 2); CE(3, 4); CE(5, 6); CE(9, 10); CE(11, 12); CE(13, 14);
+  CE(1, 9); CE(2, 10); CE(3, 11); CE(4, 12); CE(5, 13); CE(6, 14);
+  CE(4, 8); CE(5, 9); CE(6, 10); CE(7, 11);
+  CE(2, 4); CE(3, 5); CE(6, 8); CE(7, 9); CE(10, 12); CE(11, 13);
+  CE(1, 2); CE(3, 4); CE(5, 6); CE(7, 8); CE(9, 10); CE(11, 12);
+  CE(13, 14);
+}
+
+#undef CE
+
+/* one merge of the batch; returns whether its inputs were sorted */
+static bool
+merge_one(const merge3_batch *mb, size_t i, bool check)
+{
+  const int *a = mb->a[i], *b = mb->b[i], *c = mb->c[i];
+  size_t na = mb->na[i], nb = mb->nb[i], nc = mb->nc[i], n = na + nb + nc;
+  int *out = mb->out[i];
+
+  if (n <= BATCH_NET) {
+    int v[BATCH_NET];
+    bool ok = true;
+    if (check)
+      ok = is_sorted_list(a, na) & is_sorted_list(b, nb) &
+          is_sorted_list(c, nc);
+    /* an empty list may come with a NULL pointer, which memcpy forbids */
+    if (na)
+      memcpy(v, a, na * sizeof(int));
+    if (nb)
+      memcpy(v + na, b, nb * sizeof(int));
+    if (nc)
+      memcpy(v + na + nb, c, nc * sizeof(int));
+    for (size_t j = n; j < BATCH_NET; j++)
+      v[j] = INT_MAX;
+    sort16(v);
+    if (n)
+      memcpy(out, v, n * sizeof(int));
+    return ok;
+  }
+  if (n <= BATCH_SMALL) {
+    if (check)
+      return merge3_branchless_checked(a, na, b, nb, c, nc, out);
+    merge3_branchless(a, na, b, nb, c, nc, out);
+    return true;
+  }
+  if (check)
+    return merge3_checked(a, na, b, nb, c, nc, out);
+  merge3_kernel(a, na, b, nb, c, nc, out);
+  return true;
+}
+
+struct batch_job {
+  const merge3_batch *mb;
+  bool *ok;
+  unsigned nthreads;
+  bool all_ok[BATCH_MAX_THREADS];
+};
+
+static void
+batch_slice(batch_job *job, unsigned t)
+{
+  size_t i0 = slice_start(job->mb->count, t, job->nthreads);
+  size_t i1 = slice_start(job->mb->count, t + 1, job->nthreads);
+  bool all = true;
+
+  if (job->ok) {
+    for (size_t i = i0; i < i1; i++)
+      all &= job->ok[i] = merge_one(job->mb, i, true);
+  } else {
+    for (size_t i = i0; i < i1; i++)
+      merge_one(job->mb, i, false);
+  }
+  job->all_ok[t] = all;
+}
+
+bool
+sorted_merge_3way_batch(const merge3_batch *batch, bool *ok,
+    unsigned nthreads)
+{
+  batch_job job = { batch, ok, nthreads, { false } };
+  std::thread workers[BATCH_MAX_THREADS];
+  bool all = true;
+
+  if (!job.nthreads)
+    job.nthreads = std::thread::hardware_concurrency();
+  if (job.nthreads > batch->count / BATCH_MIN_PER_THREAD)
+    job.nthreads = batch->count / BATCH_MIN_PER_THREAD;
+  if (job.nthreads > BATCH_MAX_THREADS)
+    job.nthreads = BATCH_MAX_THREADS;
+  if (!job.nthreads)
+    job.nthreads = 1;
+
+  for (unsigned t = 1; t < job.nthreads; t++)
+    workers[t] = std::thread(batch_slice, &job, t);
+  batch_slice(&job, 0);
+  for (unsigned t = 1; t < job.nthreads; t++)
+    workers[t].join();
+  for (unsigned t = 0; t < job.nthreads; t++)
+    all &= job.all_ok[t];
+  return all;
+}
@@ -0,0 +1,48 @@
+/* R. Fabbri, 2025 */
+#ifndef SORTED_MERGE_BATCH_H
+#define SORTED_MERGE_BATCH_H
+
+#include <cstddef>
+
+/*
+ * A batch of independent 3-way merges in structure-of-arrays layout: merge i
+ * reads a[i][0..na[i]), b[i][0..nb[i]) and c[i][0..nc[i]) and writes
+ * na[i]+nb[i]+nc[i] ints to out[i]. Outputs must not overlap each other or
+ * any input.
+ */
+struct merge3_batch {
+  const int *const *a;
+  const size_t *na;
+  const int *const *b;
+  const size_t *nb;
+  const int *const *c;
+  const size_t *nc;
+  int *const *out;
+  size_t count;
+};
+
+/*
+ * Runs every merge of the batch back to back, for workloads made of many
+ * small merges where the per-call cost of sorted_merge_3way() dominates.
+ *
+ * Merges of at most 16 elements are copied into registers and sorted by a
+ * fixed 63-comparator network, with no branches on the data. Merges up to 64
+ * elements use the branchless scalar kernel directly, and larger ones go
+ * through the same kernel dispatch as sorted_merge_3way().
+ *
+ * @param batch     The merges to run.
+ * @param ok        If not NULL, ok[i] is set to whether the three inputs of
+ *                  merge i were sorted; out[i] is unspecified when it is
+ *                  `false`. With ok NULL the inputs are trusted and not
+ *                  checked.
+ * @param nthreads  Number of threads, including the caller; 0 uses the
+ *                  hardware concurrency. Batches with fewer than about 4096
+ *                  merges per thread use fewer threads.
+ * @return          `true` if every merge had sorted inputs (always `true`
+ *                  when ok is NULL).
+ */
+bool
+sorted_merge_3way_batch(const merge3_batch *batch, bool *ok,
+    unsigned nthreads);
+
+#endif /* SORTED_MERGE_BATCH_H */
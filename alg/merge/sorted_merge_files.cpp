@@ -0,0 +1,195 @@
+/* R. Fabbri, 2025 */
+#include "sorted_merge_files.h"
+#include "merge_kernels.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "sorted_merge_files reads little-endian files in place"
+#endif
+
+#define FILE_BUFFER_DEFAULT (4u << 20)
+
+struct write_job {
+  int fd;
+  const int *buf;
+  size_t n;
+  bool ok;
+  int err;
+};
+
+static void
+write_all(write_job *w)
+{
+  const char *p = (const char *) w->buf;
+  size_t left = w->n * sizeof(int);
+
+  w->ok = true;
+  while (left) {
+    ssize_t got = write(w->fd, p, left);
+    if (got < 0) {
+      if (errno == EINTR)
+        continue;
+      w->ok = false;
+      w->err = errno;
+      return;
+    }
+    p += got;
+    left -= got;
+  }
+}
+
+/* maps one input; empty files get a NULL run */
+static merge_file_status
+map_input(const char *path, merge_run *run)
+{
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+
+  run->data = NULL;
+  run->n = 0;
+  if (fd < 0)
+    return MERGE_FILE_IO;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return MERGE_FILE_IO;
+  }
+  if (st.st_size % sizeof(int)) {
+    close(fd);
+    return MERGE_FILE_FORMAT;
+  }
+  if (st.st_size) {
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      return MERGE_FILE_IO;
+    }
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    run->data = (const int *) p;
+    run->n = st.st_size / sizeof(int);
+  }
+  close(fd);
+  return MERGE_FILE_OK;
+}
+
+/*
+ * Merges the next n outputs into buf. win[] receives the window of every run
+ * that can contribute (the next n elements at most), then the co-rank of n
+ * inside those windows.
+ */
+static merge_file_status
+merge_chunk(const merge_run *runs, unsigned k, size_t *pos, merge_run *win,
+    size_t *split, size_t n, bool check, int *buf)
+{
+  for (unsigned i = 0; i < k; i++) {
+    size_t left = runs[i].n - pos[i];
+    win[i].data = runs[i].data + pos[i];
+    win[i].n = left < n ? left : n;
+  }
+  corank_kway(win, k, n, split);
+  for (unsigned i = 0; i < k; i++) {
+    win[i].n = split[i];
+    if (check && split[i] && (!is_sorted_list(win[i].data, split[i]) ||
+        (pos[i] && win[i].data[-1] > win[i].data[0])))
+      return MERGE_FILE_UNSORTED;
+    pos[i] += split[i];
+  }
+  if (!mergek_kernel(win, k, buf))
+    return MERGE_FILE_NOMEM;
+  return MERGE_FILE_OK;
+}
+
+merge_file_status
+sorted_merge_files(const char *const *inputs, unsigned k, const char *output,
+    const merge_file_opts *opts)
+{
+  static const merge_file_opts defaults = { 0, false, false };
+  merge_file_status st = MERGE_FILE_OK;
+  size_t bn, total = 0, done = 0;
+  write_job job[2] = { { -1, NULL, 0, true, 0 }, { -1, NULL, 0, true, 0 } };
+  std::thread writer;
+  unsigned cur = 0, nbuf;
+  int fd, err = 0;
+
+  if (!opts)
+    opts = &defaults;
+  bn = opts->buffer_elems ? opts->buffer_elems : FILE_BUFFER_DEFAULT;
+  nbuf = opts->overlap_io ? 2 : 1;
+  /* the buffer size would wrap around */
+  if (bn > SIZE_MAX / (nbuf * sizeof(int)))
+    return MERGE_FILE_NOMEM;
+
+  /* one block: runs, windows, positions and splits */
+  merge_run *runs = (merge_run *) calloc(k ? k : 1,
+      2 * sizeof(merge_run) + 2 * sizeof(size_t));
+  int *buf = (int *) malloc(nbuf * bn * sizeof(int));
+  if (!runs || !buf) {
+    free(runs);
+    free(buf);
+    return MERGE_FILE_NOMEM;
+  }
+  merge_run *win = runs + k;
+  size_t *pos = (size_t *) (win + k), *split = pos + k;
+
+  for (unsigned i = 0; i < k && st == MERGE_FILE_OK; i++) {
+    st = map_input(inputs[i], &runs[i]);
+    total += runs[i].n;
+  }
+  fd = st == MERGE_FILE_OK ?
+      open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+  if (st == MERGE_FILE_OK && fd < 0)
+    st = MERGE_FILE_IO;
+
+  while (st == MERGE_FILE_OK && done < total) {
+    size_t n = total - done < bn ? total - done : bn;
+    write_job *w = &job[cur];
+
+    st = merge_chunk(runs, k, pos, win, split, n, opts->check,
+        buf + cur * bn);
+    if (st != MERGE_FILE_OK)
+      break;
+    done += n;
+    *w = { fd, buf + cur * bn, n, true, 0 };
+    if (nbuf == 1) {
+      write_all(w);
+    } else {
+      /* the other buffer is free again once its write has finished */
+      if (writer.joinable())
+        writer.join();
+      writer = std::thread(write_all, w);
+      cur ^= 1;
+    }
+    if (!job[cur].ok) {
+      st = MERGE_FILE_IO;
+      err = job[cur].err;
+    }
+  }
+  if (writer.joinable())
+    writer.join();
+  for (unsigned b = 0; b < 2 && st == MERGE_FILE_OK; b++)
+    if (!job[b].ok) {
+      st = MERGE_FILE_IO;
+      err = job[b].err;
+    }
+
+  if (!err && st == MERGE_FILE_IO)
+    err = errno;
+  if (fd >= 0 && close(fd) < 0 && st == MERGE_FILE_OK) {
+    st = MERGE_FILE_IO;
+    err = errno;
+  }
+  for (unsigned i = 0; i < k; i++)
+    if (runs[i].n)
+      munmap((void *) runs[i].data, runs[i].n * sizeof(int));
+  free(runs);
+  free(buf);
+  if (st == MERGE_FILE_IO)
+    errno = err;
+  return st;
+}
@@ -0,0 +1,46 @@
+/* R. Fabbri, 2025 */
+#ifndef SORTED_MERGE_FILES_H
+#define SORTED_MERGE_FILES_H
+
+#include <cstddef>
+
+/*
+ * External-memory merge of sorted binary files.
+ *
+ * Each file is a raw array of little-endian 32-bit integers, and files may be
+ * larger than RAM. Inputs are memory-mapped with MADV_SEQUENTIAL, and the
+ * output goes through a bounded buffer. Each chunk of output is cut from the
+ * inputs by a co-rank search restricted to the next buffer-length window of
+ * every file, so only pages about to be merged are touched.
+ */
+struct merge_file_opts {
+  size_t buffer_elems;  /* output buffer length in ints; 0 = 4M (16 MB) */
+  bool overlap_io;      /* write one buffer on a helper thread while the
+                           next one is merged (uses twice the buffer) */
+  bool check;           /* verify that every input is sorted */
+};
+
+enum merge_file_status {
+  MERGE_FILE_OK,
+  MERGE_FILE_IO,        /* open, mmap, write or close failed; see errno */
+  MERGE_FILE_FORMAT,    /* an input length is not a multiple of 4 bytes */
+  MERGE_FILE_UNSORTED,  /* opts->check found an input out of order */
+  MERGE_FILE_NOMEM      /* also for a buffer_elems too large to allocate */
+};
+
+/*
+ * Merges k sorted input files into the output file, which is created or
+ * truncated.
+ *
+ * @param inputs  Paths of the k input files.
+ * @param k       Number of inputs.
+ * @param output  Path of the output file. It must not be one of the inputs.
+ * @param opts    Options; NULL selects the defaults (no overlap, no check).
+ * @return        MERGE_FILE_OK, or the first error met. On error the output
+ *                file is left truncated at an unspecified length.
+ */
+merge_file_status
+sorted_merge_files(const char *const *inputs, unsigned k, const char *output,
+    const merge_file_opts *opts);
+
+#endif /* SORTED_MERGE_FILES_H */
@@ -0,0 +1,152 @@
+/* R. Fabbri, 2025 */
+#include "sorted_merge_inplace.h"
+#include "merge_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+/* smallest scratch buffer, in ints, whatever the input size */
+#define INPLACE_MIN_SCRATCH 16384
+
+/*
+ * Merges f[0, n1) with f[n1, n1 + n2), moving the first run to buf. The
+ * write position never passes the read position in the second run, and what
+ * is left of the second run at the end is already in place.
+ */
+static void
+merge_lo(int *f, size_t n1, size_t n2, int *buf)
+{
+  memcpy(buf, f, n1 * sizeof(int));
+  const int *a = buf, *ae = buf + n1, *b = f + n1, *be = b + n2;
+  int *o = f;
+
+  while (a < ae && b < be) {
+    bool tb = *b < *a;
+    *o++ = tb ? *b : *a;
+    b += tb;
+    a += !tb;
+  }
+  memcpy(o, a, (ae - a) * sizeof(int));
+}
+
+/* merge_lo() from the top, moving the second run to buf */
+static void
+merge_hi(int *f, size_t n1, size_t n2, int *buf)
+{
+  memcpy(buf, f + n1, n2 * sizeof(int));
+  const int *a = f + n1, *b = buf + n2;
+  int *o = f + n1 + n2;
+
+  while (a > f && b > buf) {
+    bool ta = b[-1] < a[-1];
+    *--o = ta ? a[-1] : b[-1];
+    a -= ta;
+    b -= !ta;
+  }
+  memcpy(f, buf, (b - buf) * sizeof(int));
+}
+
+/* Swaps the adjacent blocks f[0, n1) and f[n1, n1 + n2). */
+static void
+swap_blocks(int *f, size_t n1, size_t n2, int *buf, size_t nbuf)
+{
+  if (!n1 || !n2)
+    return;
+  if (n2 <= nbuf && n2 <= n1) {
+    memcpy(buf, f + n1, n2 * sizeof(int));
+    memmove(f + n2, f, n1 * sizeof(int));
+    memcpy(f, buf, n2 * sizeof(int));
+  } else if (n1 <= nbuf) {
+    memcpy(buf, f, n1 * sizeof(int));
+    memmove(f, f + n1, n2 * sizeof(int));
+    memcpy(f + n2, buf, n1 * sizeof(int));
+  } else {
+    std::rotate(f, f + n1, f + n1 + n2);
+  }
+}
+
+/*
+ * Merges the adjacent runs f[0, n1) and f[n1, n1 + n2). The smaller half of
+ * each split recurses and the larger one loops, so the stack stays
+ * O(log n) deep.
+ */
+static void
+merge2_inplace(int *f, size_t n1, size_t n2, int *buf, size_t nbuf)
+{
+  while (n1 && n2) {
+    /* the head of the first run and the tail of the second may already be
+     * in place; disjoint runs end here after two searches */
+    size_t skip = gallop_upper(f, n1, f[n1]);
+    f += skip;
+    n1 -= skip;
+    if (!n1)
+      return;
+    n2 = std::lower_bound(f + n1, f + n1 + n2, f[n1 - 1]) - (f + n1);
+    if (!n2)
+      return;
+
+    if (std::min(n1, n2) <= nbuf) {
+      if (n1 <= n2)
+        merge_lo(f, n1, n2, buf);
+      else
+        merge_hi(f, n1, n2, buf);
+      return;
+    }
+
+    size_t c1, c2;
+    if (n1 >= n2) {
+      c1 = n1 / 2;
+      c2 = std::lower_bound(f + n1, f + n1 + n2, f[c1]) - (f + n1);
+    } else {
+      c2 = n2 / 2;
+      c1 = std::upper_bound(f, f + n1, f[n1 + c2]) - f;
+    }
+    /* f[c1, n1) and f[n1, n1 + c2) trade places; every element left of the
+     * new boundary c1 + c2 is then <= every element right of it */
+    swap_blocks(f + c1, n1 - c1, c2, buf, nbuf);
+    size_t m = c1 + c2;
+    if (m <= n1 + n2 - m) {
+      merge2_inplace(f, c1, c2, buf, nbuf);
+      f += m;
+      n1 -= c1;
+      n2 -= c2;
+    } else {
+      merge2_inplace(f + m, n1 - c1, n2 - c2, buf, nbuf);
+      n1 = c1;
+      n2 = c2;
+    }
+  }
+}
+
+void
+sorted_merge_3way_inplace_buf(int *v, size_t na, size_t nb, size_t nc,
+    int *buf, size_t nbuf)
+{
+  if (na <= nc) {
+    merge2_inplace(v, na, nb, buf, nbuf);
+    merge2_inplace(v, na + nb, nc, buf, nbuf);
+  } else {
+    merge2_inplace(v + na, nb, nc, buf, nbuf);
+    merge2_inplace(v, na, nb + nc, buf, nbuf);
+  }
+}
+
+bool
+sorted_merge_3way_inplace(int *v, size_t na, size_t nb, size_t nc)
+{
+  if (!is_sorted_list(v, na) || !is_sorted_list(v + na, nb) ||
+      !is_sorted_list(v + na + nb, nc))
+    return false;
+
+  size_t total = na + nb + nc;
+  size_t nbuf = std::min(total,
+      std::max((size_t) std::sqrt((double) total), (size_t) INPLACE_MIN_SCRATCH));
+  int *buf = (int *) malloc(nbuf * sizeof(int));
+  if (!buf)
+    nbuf = 0;
+
+  sorted_merge_3way_inplace_buf(v, na, nb, nc, buf, nbuf);
+  free(buf);
+  return true;
+}
@@ -0,0 +1,36 @@
+/* R. Fabbri, 2025 */
+#ifndef SORTED_MERGE_INPLACE_H
+#define SORTED_MERGE_INPLACE_H
+
+#include <cstddef>
+
+/*
+ * Merges three adjacent sorted runs of one array in place:
+ * v[0, na), v[na, na + nb) and v[na + nb, na + nb + nc) become the sorted
+ * v[0, na + nb + nc), without an output array.
+ *
+ * The adjacent pair with the smaller total is merged first, then the
+ * result with the third. Each 2-way merge splits the longer run at its
+ * middle, finds the matching point in the other run by binary search and
+ * swaps the two inner blocks, recursing until one side fits in the scratch
+ * buffer, where it is merged linearly. The scratch buffer holds about
+ * sqrt(n) ints (at least 64 KB); if it cannot be allocated the merge still
+ * completes with rotations alone, in O(n log n) moves.
+ *
+ * @param v   Array holding the three runs back to back.
+ * @return    `true` on success, `false` if a run was not sorted (v is left
+ *            untouched).
+ */
+bool
+sorted_merge_3way_inplace(int *v, size_t na, size_t nb, size_t nc);
+
+/*
+ * sorted_merge_3way_inplace() with a caller-supplied scratch buffer of nbuf
+ * ints (nbuf may be 0) that must not overlap v. The runs must be sorted;
+ * they are not checked.
+ */
+void
+sorted_merge_3way_inplace_buf(int *v, size_t na, size_t nb, size_t nc,
+    int *buf, size_t nbuf);
+
+#endif /* SORTED_MERGE_INPLACE_H */
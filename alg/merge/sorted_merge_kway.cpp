@@ -0,0 +1,13 @@
+/* R. Fabbri, 2025 */
+#include "sorted_merge_kway.h"
+#include "merge_kernels.h"
+
+bool
+sorted_merge_kway(const merge_run *runs, unsigned k, int *out)
+{
+  for (unsigned i = 0; i < k; i++)
+    if (!is_sorted_list(runs[i].data, runs[i].n))
+      return false;
+
+  return mergek_kernel(runs, k, out);
+}
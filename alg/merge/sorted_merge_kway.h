@@ -0,0 +1,33 @@
+/* R. Fabbri, 2025 */
+#ifndef SORTED_MERGE_KWAY_H
+#define SORTED_MERGE_KWAY_H
+
+#include <cstddef>
+
+/*
+ * One sorted input run: `n` integers starting at `data`.
+ */
+struct merge_run {
+  const int *data;
+  size_t n;
+};
+
+/*
+ * Merges k sorted integer runs into a single sorted list in one pass.
+ *
+ * Runs are merged through a tournament (loser) tree, so each output element
+ * costs about log2(k) comparisons and every input element is read once.
+ * k = 1, 2 and 3 are dispatched to dedicated kernels; sorted_merge_3way() is
+ * the k = 3 case. Equal keys are emitted in run order.
+ *
+ * @param runs  Array of k input runs. Runs may be empty.
+ * @param k     Number of runs.
+ * @param out   Output list with room for the sum of all run lengths. It must
+ *              not overlap any run.
+ * @return      `true` if the merge was done and all runs were sorted,
+ *              `false` otherwise (nothing is written in that case).
+ */
+bool
+sorted_merge_kway(const merge_run *runs, unsigned k, int *out);
+
+#endif /* SORTED_MERGE_KWAY_H */
@@ -0,0 +1,66 @@
+/* R. Fabbri, 2025 */
+#include "sorted_merge_3way.h"
+#include "merge_kernels.h"
+#include <cstdint>
+#include <thread>
+
+#define PAR_MIN_PER_THREAD (1 << 16)
+
+struct par_check {
+  const merge_run *runs;
+  unsigned nthreads;
+  bool ok[MERGE_MAX_THREADS];
+};
+
+/* checks the t-th slice of every list, including the pair across its start */
+static void
+check_slice(void *ctx, unsigned t)
+{
+  par_check *pc = (par_check *) ctx;
+  bool ok = true;
+
+  for (unsigned i = 0; i < 3; i++) {
+    size_t n = pc->runs[i].n;
+    size_t lo = slice_start(n, t, pc->nthreads);
+    size_t hi = slice_start(n, t + 1, pc->nthreads);
+    if (lo)
+      lo--;
+    ok &= is_sorted_list(pc->runs[i].data + lo, hi - lo);
+  }
+  pc->ok[t] = ok;
+}
+
+bool
+sorted_merge_3way_parallel(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc, unsigned nthreads)
+{
+  merge_run runs[3] = { { list_a, na }, { list_b, nb }, { list_c, nc } };
+  const size_t max = SIZE_MAX / sizeof(int);
+  size_t total;
+  par_check pc;
+
+  /* as in sorted_merge_3way64(), before any list is read */
+  if (na > max || nb > max - na || nc > max - na - nb)
+    return false;
+  total = na + nb + nc;
+  if (!nthreads)
+    nthreads = std::thread::hardware_concurrency();
+  if (nthreads > total / PAR_MIN_PER_THREAD)
+    nthreads = total / PAR_MIN_PER_THREAD;
+  if (nthreads > MERGE_MAX_THREADS)
+    nthreads = MERGE_MAX_THREADS;
+  if (!nthreads)
+    nthreads = 1;
+
+  pc.runs = runs;
+  pc.nthreads = nthreads;
+  merge_run_workers(nthreads, check_slice, &pc);
+  for (unsigned t = 0; t < nthreads; t++)
+    if (!pc.ok[t])
+      return false;
+  merge3_slices(runs, total, list_abc, nthreads);
+  return true;
+}
@@ -0,0 +1,330 @@
+/* R. Fabbri, 2025 */
+#include "sorted_merge_set.h"
+#include "merge_kernels.h"
+#include <cstdlib>
+
+/*
+ * Distinct union: the branchless merge kernels with the output cursor
+ * advanced only when the value differs from the last one written. Writes
+ * always happen, so out[o] is scratch until a new value lands there.
+ */
+static size_t
+union_tail(const int *v, size_t n, int *out, size_t o, bool any, int last)
+{
+  for (size_t i = 0; i < n; i++) {
+    out[o] = v[i];
+    o += !any || v[i] != last;
+    any = true;
+    last = v[i];
+  }
+  return o;
+}
+
+static size_t
+union2(const int *a, const int *ea, const int *b, const int *eb, int *out,
+    size_t o, bool any, int last)
+{
+  for (;;) {
+    size_t m = ea - a < eb - b ? ea - a : eb - b;
+    if (!m)
+      break;
+    do {
+      int va = *a, vb = *b;
+      bool ta = va <= vb;
+      int v = ta ? va : vb;
+      out[o] = v;
+      o += !any || v != last;
+      any = true;
+      last = v;
+      a += ta;
+      b += !ta;
+    } while (--m);
+  }
+  if (a < ea)
+    return union_tail(a, ea - a, out, o, any, last);
+  return union_tail(b, eb - b, out, o, any, last);
+}
+
+size_t
+sorted_union_3way(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc)
+{
+  const int *a = list_a, *b = list_b, *c = list_c;
+  const int *ea = a + na, *eb = b + nb, *ec = c + nc;
+  size_t o = 0;
+  bool any = false;
+  int last = 0;
+
+  for (;;) {
+    size_t m = ea - a < eb - b ? ea - a : eb - b;
+    if ((size_t) (ec - c) < m)
+      m = ec - c;
+    if (!m)
+      break;
+    do {
+      int va = *a, vb = *b, vc = *c;
+      int vbc = vb <= vc ? vb : vc;
+      bool ta = va <= vbc;
+      bool tb = !ta & (vb <= vc);
+      int v = ta ? va : vbc;
+      list_abc[o] = v;
+      o += !any || v != last;
+      any = true;
+      last = v;
+      a += ta;
+      b += tb;
+      c += !ta & !tb;
+    } while (--m);
+  }
+  if (a == ea)
+    return union2(b, eb, c, ec, list_abc, o, any, last);
+  if (b == eb)
+    return union2(a, ea, c, ec, list_abc, o, any, last);
+  return union2(a, ea, b, eb, list_abc, o, any, last);
+}
+
+/*
+ * Leapfrog intersection: x is the candidate value. Each list in turn skips
+ * to its first element >= x; a larger element becomes the new candidate and
+ * the round starts over, and when every list lands on x it is emitted. With
+ * exponential search each skip costs O(log gap).
+ */
+static size_t
+intersect(const int **cur, const int **end, unsigned k, int *out)
+{
+  size_t o = 0;
+  unsigned agree = 0, i = 0;
+
+  if (!k)
+    return 0;
+  for (unsigned j = 0; j < k; j++)
+    if (cur[j] == end[j])
+      return 0;
+  int x = *cur[0];
+  for (;;) {
+    cur[i] += gallop_lower(cur[i], end[i] - cur[i], x);
+    if (cur[i] == end[i])
+      return o;
+    if (*cur[i] > x) {
+      x = *cur[i];
+      agree = 0;
+    }
+    if (++agree == k) {
+      out[o++] = x;
+      /* x is done; the next candidate is above it */
+      if (x == INT_MAX)
+        return o;
+      x++;
+      agree = 0;
+    }
+    i = i + 1 == k ? 0 : i + 1;
+  }
+}
+
+size_t
+sorted_intersect_3way(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc)
+{
+  const int *cur[3] = { list_a, list_b, list_c };
+  const int *end[3] = { list_a + na, list_b + nb, list_c + nc };
+
+  return intersect(cur, end, 3, list_abc);
+}
+
+size_t
+sorted_threshold_3way(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    unsigned m, int *list_abc)
+{
+  const int *a = list_a, *b = list_b, *c = list_c;
+  const int *ea = a + na, *eb = b + nb, *ec = c + nc;
+  size_t o = 0;
+
+  if (m <= 1)
+    return sorted_union_3way(list_a, na, list_b, nb, list_c, nc, list_abc);
+  if (m == 3)
+    return sorted_intersect_3way(list_a, na, list_b, nb, list_c, nc, list_abc);
+  if (m > 3)
+    return 0;
+
+  /* m == 2: stop once fewer than two lists are left */
+  while ((a < ea) + (b < eb) + (c < ec) >= 2) {
+    int v = INT_MAX;
+    unsigned cnt = 0;
+    if (a < ea && *a < v) v = *a;
+    if (b < eb && *b < v) v = *b;
+    if (c < ec && *c < v) v = *c;
+    if (a < ea && *a == v) {
+      cnt++;
+      a += gallop_upper(a, ea - a, v);
+    }
+    if (b < eb && *b == v) {
+      cnt++;
+      b += gallop_upper(b, eb - b, v);
+    }
+    if (c < ec && *c == v) {
+      cnt++;
+      c += gallop_upper(c, ec - c, v);
+    }
+    list_abc[o] = v;
+    o += cnt >= 2;
+  }
+  return o;
+}
+
+/* distinct values of cur[0] found in none of cur[1..k) */
+static size_t
+difference(const int **cur, const int **end, unsigned k, int *out)
+{
+  const int *a = cur[0], *ea = end[0];
+  size_t o = 0;
+
+  while (a < ea) {
+    int x = *a;
+    bool found = false;
+    for (unsigned i = 1; i < k && !found; i++) {
+      cur[i] += gallop_lower(cur[i], end[i] - cur[i], x);
+      found = cur[i] < end[i] && *cur[i] == x;
+    }
+    out[o] = x;
+    o += !found;
+    a += gallop_upper(a, ea - a, x);
+  }
+  return o;
+}
+
+size_t
+sorted_difference_3way(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc)
+{
+  const int *cur[3] = { list_a, list_b, list_c };
+  const int *end[3] = { list_a + na, list_b + nb, list_c + nc };
+
+  return difference(cur, end, 3, list_abc);
+}
+
+/*
+ * k-way union and threshold: walk the runs through the loser tree. Equal
+ * keys come out in run order, so all the runs holding a value v appear one
+ * after the other, and each is pushed past its copies of v at once.
+ */
+static size_t
+threshold_kway(const merge_run *runs, unsigned k, unsigned m, int *out)
+{
+  size_t o = 0;
+
+  if (k < 2) {
+    if (!k || m > 1)
+      return 0;
+    return union_tail(runs[0].data, runs[0].n, out, 0, false, 0);
+  }
+  uint64_t *tree = (uint64_t *) malloc(3 * (size_t) k * sizeof(uint64_t));
+  const int **cur = (const int **) malloc(2 * (size_t) k * sizeof(int *));
+  if (!tree || !cur) {
+    free(tree);
+    free(cur);
+    return (size_t) -1;
+  }
+  const int **end = cur + k;
+  for (unsigned i = 0; i < k; i++) {
+    cur[i] = runs[i].data;
+    end[i] = runs[i].data + runs[i].n;
+    tree[2 * k + i] = runs[i].n ? run_key(*cur[i], i) : KEY_DONE;
+  }
+
+  uint64_t w = loser_tree_build(tree, k);
+  while (w != KEY_DONE) {
+    int v = key_value(w);
+    unsigned cnt = 0;
+    do {
+      unsigned r = (unsigned) w;
+      cnt++;
+      cur[r] += gallop_upper(cur[r], end[r] - cur[r], v);
+      w = cur[r] < end[r] ? run_key(*cur[r], r) : KEY_DONE;
+      w = loser_tree_replay(tree, k, r, w);
+    } while (w != KEY_DONE && key_value(w) == v);
+    out[o] = v;
+    o += cnt >= m;
+  }
+
+  free(tree);
+  free(cur);
+  return o;
+}
+
+size_t
+sorted_union_kway(const merge_run *runs, unsigned k, int *out)
+{
+  if (k == 3)
+    return sorted_union_3way(runs[0].data, runs[0].n, runs[1].data,
+        runs[1].n, runs[2].data, runs[2].n, out);
+  return threshold_kway(runs, k, 1, out);
+}
+
+size_t
+sorted_threshold_kway(const merge_run *runs, unsigned k, unsigned m, int *out)
+{
+  if (m == k)
+    return sorted_intersect_kway(runs, k, out);
+  if (m > k)
+    return 0;
+  return threshold_kway(runs, k, m ? m : 1, out);
+}
+
+/* cursors for the array-based algorithms; small k stays on the stack */
+#define SET_STACK_RUNS 64
+
+size_t
+sorted_intersect_kway(const merge_run *runs, unsigned k, int *out)
+{
+  const int *stack[2 * SET_STACK_RUNS], **cur = stack;
+  size_t o;
+
+  if (k > SET_STACK_RUNS) {
+    cur = (const int **) malloc(2 * (size_t) k * sizeof(int *));
+    if (!cur)
+      return (size_t) -1;
+  }
+  for (unsigned i = 0; i < k; i++) {
+    cur[i] = runs[i].data;
+    cur[k + i] = runs[i].data + runs[i].n;
+  }
+  o = intersect(cur, cur + k, k, out);
+  if (cur != stack)
+    free(cur);
+  return o;
+}
+
+size_t
+sorted_difference_kway(const merge_run *runs, unsigned k, int *out)
+{
+  const int *stack[2 * SET_STACK_RUNS], **cur = stack;
+  size_t o;
+
+  if (!k)
+    return 0;
+  if (k > SET_STACK_RUNS) {
+    cur = (const int **) malloc(2 * (size_t) k * sizeof(int *));
+    if (!cur)
+      return (size_t) -1;
+  }
+  for (unsigned i = 0; i < k; i++) {
+    cur[i] = runs[i].data;
+    cur[k + i] = runs[i].data + runs[i].n;
+  }
+  o = difference(cur, cur + k, k, out);
+  if (cur != stack)
+    free(cur);
+  return o;
+}
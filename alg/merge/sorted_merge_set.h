@@ -0,0 +1,85 @@
+/* R. Fabbri, 2025 */
+#ifndef SORTED_MERGE_SET_H
+#define SORTED_MERGE_SET_H
+
+#include <cstddef>
+#include "sorted_merge_kway.h"
+
+/*
+ * Single-pass set algebra over sorted integer lists.
+ *
+ * Each list is read as the set of its distinct values; duplicates inside a
+ * list are allowed and count once. The output holds distinct values in
+ * increasing order, and every call returns how many it wrote. Inputs must be
+ * sorted (not checked; unsorted input gives an unspecified result). The output
+ * must not overlap any input.
+ *
+ * Intersection and difference find each value in the other lists by
+ * exponential search from the current position. They cost about one compare
+ * per element when the lists are of similar size, and O(log gap) per value of
+ * the smallest list when the sizes differ widely.
+ */
+
+/*
+ * Values present in at least one list. list_abc needs room for na+nb+nc.
+ */
+size_t
+sorted_union_3way(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc);
+
+/*
+ * Values present in all three lists. list_abc needs room for min(na,nb,nc).
+ */
+size_t
+sorted_intersect_3way(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc);
+
+/*
+ * Values present in at least m of the three lists: m = 1 is the union, m = 3
+ * the intersection and m = 0 is treated as 1. list_abc needs room for
+ * na+nb+nc.
+ */
+size_t
+sorted_threshold_3way(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    unsigned m, int *list_abc);
+
+/*
+ * Values of list_a present in neither list_b nor list_c. list_abc needs room
+ * for na.
+ */
+size_t
+sorted_difference_3way(
+    const int *list_a, size_t na,
+    const int *list_b, size_t nb,
+    const int *list_c, size_t nc,
+    int *list_abc);
+
+/*
+ * k-way versions of the above. Union and threshold walk the runs through a
+ * loser tree, skipping repeated values of a run with one exponential search.
+ * The difference is runs[0] minus all other runs. Every k-way function
+ * returns (size_t) -1 if its work space cannot be allocated; intersection
+ * and difference only allocate for k > 64.
+ */
+size_t
+sorted_union_kway(const merge_run *runs, unsigned k, int *out);
+
+size_t
+sorted_intersect_kway(const merge_run *runs, unsigned k, int *out);
+
+size_t
+sorted_threshold_kway(const merge_run *runs, unsigned k, unsigned m, int *out);
+
+size_t
+sorted_difference_kway(const merge_run *runs, unsigned k, int *out);
+
+#endif /* SORTED_MERGE_SET_H */
@@ -0,0 +1,166 @@
+/* R. Fabbri, 2025 */
+#include "sorted_merge_varint.h"
+#include "merge_cursor.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+/* values decoded per refill and merged per encoder call */
+#define VARINT_BLOCK 2048
+
+/*
+ * Values are coded with the sign bit flipped, which maps sorted ints to
+ * sorted unsigned ints, so gaps never go negative.
+ */
+#define SIGN_FLIP 0x80000000u
+
+struct varint_reader {
+  const unsigned char *p, *end;
+  size_t left;      /* values not decoded yet */
+  uint32_t prev;    /* last value decoded, sign flipped */
+};
+
+struct varint_writer {
+  unsigned char *p;
+  uint32_t prev;
+};
+
+/*
+ * Decodes the next min(max, left) values into out. When the next eight bytes
+ * have no continuation bit they are eight one-byte gaps, decoded without
+ * testing each byte. Otherwise a gap of up to four bytes is found from the
+ * first clear high bit in a 4-byte word and unpacked without a branch per
+ * byte; only 5-byte gaps and the last bytes of the input go byte by byte.
+ */
+static size_t
+decode_block(varint_reader *r, int *out, size_t max)
+{
+  size_t m = max < r->left ? max : r->left, t = 0;
+  const unsigned char *p = r->p;
+  uint32_t prev = r->prev;
+
+  while (t < m) {
+    if (m - t >= 8 && r->end - p >= 8) {
+      uint64_t w;
+      memcpy(&w, p, 8);
+      if (!(w & 0x8080808080808080ull)) {
+        for (int i = 0; i < 8; i++) {
+          prev += p[i];
+          out[t + i] = (int) (prev ^ SIGN_FLIP);
+        }
+        p += 8;
+        t += 8;
+        continue;
+      }
+    }
+    uint32_t d;
+    if (r->end - p >= 4) {
+      uint32_t w = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+      uint32_t stop = ~w & 0x80808080u;
+      if (stop) {
+        unsigned len = __builtin_ctz(stop) / 8 + 1;
+        d = (w & 0x7f) | (w >> 1 & 0x3f80) | (w >> 2 & 0x1fc000) |
+            (w >> 3 & 0xfe00000);
+        prev += d & 0xffffffffu >> (32 - 7 * len);
+        out[t++] = (int) (prev ^ SIGN_FLIP);
+        p += len;
+        continue;
+      }
+    }
+    d = 0;
+    unsigned shift = 0;
+    unsigned char b;
+    do {
+      b = *p++;
+      d |= (uint32_t) (b & 0x7f) << shift;
+      shift += 7;
+    } while (b & 0x80);
+    prev += d;
+    out[t++] = (int) (prev ^ SIGN_FLIP);
+  }
+  r->p = p;
+  r->prev = prev;
+  r->left -= m;
+  return m;
+}
+
+static void
+encode_block(varint_writer *w, const int *v, size_t n)
+{
+  unsigned char *p = w->p;
+  uint32_t prev = w->prev;
+
+  for (size_t i = 0; i < n; i++) {
+    uint32_t u = (uint32_t) v[i] ^ SIGN_FLIP, d = u - prev;
+    prev = u;
+    while (d >= 0x80) {
+      *p++ = (unsigned char) (d | 0x80);
+      d >>= 7;
+    }
+    *p++ = (unsigned char) d;
+  }
+  w->p = p;
+  w->prev = prev;
+}
+
+size_t
+varint_encode(const int *v, size_t n, unsigned char *out)
+{
+  varint_writer w = { out, 0 };
+  encode_block(&w, v, n);
+  return w.p - out;
+}
+
+void
+varint_decode(const varint_list *l, int *out)
+{
+  varint_reader r = { l->data, l->data + l->bytes, l->n, 0 };
+  decode_block(&r, out, l->n);
+}
+
+struct varint_source {
+  varint_reader r;
+  int buf[VARINT_BLOCK];
+};
+
+static bool
+refill_varint(void *ctx, const int **data, size_t *n)
+{
+  varint_source *s = (varint_source *) ctx;
+  if (!s->r.left)
+    return false;
+  *n = decode_block(&s->r, s->buf, VARINT_BLOCK);
+  *data = s->buf;
+  return true;
+}
+
+size_t
+sorted_merge_varint(const varint_list *in, unsigned k, unsigned char *out)
+{
+  varint_source *vs = (varint_source *) malloc(
+      (k ? k : 1) * sizeof(varint_source));
+  merge_source *src = (merge_source *) malloc((k ? k : 1) * sizeof(merge_source));
+  int *batch = (int *) malloc(VARINT_BLOCK * sizeof(int));
+  merge_cursor *c = NULL;
+  size_t res = (size_t) -1;
+
+  if (vs && src && batch) {
+    for (unsigned i = 0; i < k; i++) {
+      vs[i].r = { in[i].data, in[i].data + in[i].bytes, in[i].n, 0 };
+      src[i] = { NULL, 0, refill_varint, &vs[i] };
+    }
+    c = merge_cursor_create(src, k);
+  }
+  if (c) {
+    varint_writer w = { out, 0 };
+    size_t got;
+    while ((got = merge_cursor_next_batch(c, batch, VARINT_BLOCK)))
+      encode_block(&w, batch, got);
+    res = w.p - out;
+  }
+  merge_cursor_destroy(c);
+  free(batch);
+  free(src);
+  free(vs);
+  return res;
+}
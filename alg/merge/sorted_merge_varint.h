@@ -0,0 +1,55 @@
+/* R. Fabbri, 2025 */
+#ifndef SORTED_MERGE_VARINT_H
+#define SORTED_MERGE_VARINT_H
+
+#include <cstddef>
+
+/*
+ * Merging of compressed sorted lists.
+ *
+ * A list is stored as the gaps between consecutive values, each written as
+ * a variable-length integer: 7 bits per byte, low bits first, with the high
+ * bit set on every byte but the last. The first gap is measured from
+ * INT_MIN, so any sorted ints encode and every gap fits in 32 bits, at most
+ * 5 bytes. Lists of dense IDs take about one byte per value.
+ *
+ * Inputs are trusted: the lists must be sorted and well formed.
+ */
+struct varint_list {
+  const unsigned char *data;
+  size_t bytes;   /* encoded length */
+  size_t n;       /* number of values */
+};
+
+/* worst-case encoded size of n values */
+#define VARINT_MAX_BYTES(n) (5 * (size_t) (n))
+
+/*
+ * Encodes the sorted v[0, n) into out, which must have room for
+ * VARINT_MAX_BYTES(n) bytes.
+ *
+ * @return  The number of bytes written.
+ */
+size_t
+varint_encode(const int *v, size_t n, unsigned char *out);
+
+/* Decodes all l->n values of l into out. */
+void
+varint_decode(const varint_list *l, int *out);
+
+/*
+ * Merges k compressed lists into a compressed output without decoding them
+ * whole: every input is decoded 2048 values at a time into a
+ * merge_cursor source, and each merged block is encoded as soon as it is
+ * ready. Besides the compressed data, memory use is about 8 KB per list.
+ * Runs of one-byte gaps, the common case for dense IDs, are decoded eight
+ * at a time.
+ *
+ * @param in   The k input lists.
+ * @param out  Room for VARINT_MAX_BYTES() of the total number of values.
+ * @return     The number of bytes written, or (size_t) -1 if out of memory.
+ */
+size_t
+sorted_merge_varint(const varint_list *in, unsigned k, unsigned char *out);
+
+#endif /* SORTED_MERGE_VARINT_H */
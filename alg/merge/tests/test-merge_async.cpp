@@ -0,0 +1,109 @@
+/* R. Fabbri, 2025 */
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <random>
+
+#include <merge_async.h>
+
+struct collected {
+  std::vector<int> out;
+  int ends;
+};
+
+static void
+collect(void *ctx, const int *data, size_t n)
+{
+  collected *c = (collected *) ctx;
+  if (!n)
+    c->ends++;
+  else
+    c->out.insert(c->out.end(), data, data + n);
+}
+
+// Pushes v in chunks of random length, yielding now and then so the stages
+// see their inputs run dry and refill.
+static void
+produce(merge_stage *s, unsigned input, const std::vector<int> *v,
+    unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> len(0, 40);
+  size_t pos = 0;
+  while (pos < v->size()) {
+    size_t n = std::min(len(gen), v->size() - pos);
+    merge_stage_push(s, input, v->data() + pos, n);
+    pos += n;
+    if (gen() % 4 == 0)
+      std::this_thread::yield();
+  }
+  merge_stage_close(s, input);
+}
+
+// Several stages with different fan-in multiplexed on one executor, with
+// queues small enough that producers block and the rings wrap.
+TEST(MergeAsyncTest, StagesShareExecutor)
+{
+  static const unsigned fan_in[] = { 3, 3, 1, 2, 5, 3 };
+  const unsigned nstages = sizeof(fan_in) / sizeof(fan_in[0]);
+  std::mt19937 gen(21);
+  std::vector<std::vector<int>> lists[nstages];
+  std::vector<int> want[nstages];
+  collected got[nstages];
+  merge_stage *st[nstages];
+  std::vector<std::thread> producers;
+
+  merge_executor *ex = merge_executor_create();
+  ASSERT_NE(nullptr, ex);
+  for (unsigned s = 0; s < nstages; ++s) {
+    got[s].ends = 0;
+    st[s] = merge_stage_create(ex, fan_in[s], 16 + 7 * s, collect, &got[s]);
+    ASSERT_NE(nullptr, st[s]);
+    lists[s].resize(fan_in[s]);
+    for (auto &l : lists[s]) {
+      l.resize(std::uniform_int_distribution<size_t>(0, 3000)(gen));
+      std::uniform_int_distribution<int> val(-500, s % 2 ? 500 : 1 << 30);
+      for (int &x : l)
+        x = val(gen);
+      std::sort(l.begin(), l.end());
+      want[s].insert(want[s].end(), l.begin(), l.end());
+    }
+    std::sort(want[s].begin(), want[s].end());
+  }
+  for (unsigned s = 0; s < nstages; ++s)
+    for (unsigned i = 0; i < fan_in[s]; ++i)
+      producers.emplace_back(produce, st[s], i, &lists[s][i], 100 * s + i);
+  for (std::thread &t : producers)
+    t.join();
+  for (unsigned s = 0; s < nstages; ++s) {
+    merge_stage_destroy(st[s]);
+    EXPECT_EQ(1, got[s].ends) << "stage " << s;
+    EXPECT_EQ(want[s], got[s].out) << "stage " << s;
+  }
+  merge_executor_destroy(ex);
+}
+
+TEST(MergeAsyncTest, EmptyInputs)
+{
+  merge_executor *ex = merge_executor_create();
+  ASSERT_NE(nullptr, ex);
+  collected c0 = { {}, 0 }, c3 = { {}, 0 };
+  merge_stage *s0 = merge_stage_create(ex, 0, 0, collect, &c0);
+  merge_stage *s3 = merge_stage_create(ex, 3, 4, collect, &c3);
+  ASSERT_TRUE(s0 && s3);
+  int v[] = { 1, 2, 3, 4, 5, 6 };
+  // a queue of 4 takes 6 values only because the other inputs are closed
+  merge_stage_close(s3, 0);
+  merge_stage_close(s3, 1);
+  merge_stage_push(s3, 2, v, 6);
+  merge_stage_close(s3, 2);
+  merge_stage_destroy(s3);
+  merge_stage_destroy(s0);
+  EXPECT_EQ(1, c0.ends);
+  EXPECT_TRUE(c0.out.empty());
+  EXPECT_EQ(1, c3.ends);
+  EXPECT_EQ(std::vector<int>(v, v + 6), c3.out);
+  merge_executor_destroy(ex);
+}
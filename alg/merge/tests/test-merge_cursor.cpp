@@ -0,0 +1,89 @@
+/* R. Fabbri, 2025 */
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+#include <random>
+
+#include <merge_cursor.h>
+
+// A stream over a vector, handed out in chunks of random length (some empty)
+// through a scratch buffer that is overwritten at every refill.
+struct chunked_stream {
+  const std::vector<int> *v;
+  size_t pos;
+  std::mt19937 *gen;
+  int chunk[64];
+};
+
+static bool
+refill_chunk(void *ctx, const int **data, size_t *n)
+{
+  chunked_stream *s = (chunked_stream *) ctx;
+  if (s->pos == s->v->size())
+    return false;
+  size_t len = std::uniform_int_distribution<size_t>(0, 64)(*s->gen);
+  len = std::min(len, s->v->size() - s->pos);
+  std::copy(s->v->begin() + s->pos, s->v->begin() + s->pos + len, s->chunk);
+  std::fill(s->chunk + len, s->chunk + 64, -1);
+  s->pos += len;
+  *data = s->chunk;
+  *n = len;
+  return true;
+}
+
+static void
+check_cursor(unsigned k, bool chunked, size_t batch, int max_val, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> len(0, 300);
+  std::uniform_int_distribution<int> val(0, max_val);
+  std::vector<std::vector<int>> lists(k);
+  std::vector<chunked_stream> streams(k);
+  std::vector<merge_source> src(k);
+  std::vector<int> all, got, out(batch);
+
+  for (unsigned i = 0; i < k; ++i) {
+    lists[i].resize(len(gen));
+    for (int &x : lists[i])
+      x = val(gen);
+    std::sort(lists[i].begin(), lists[i].end());
+    all.insert(all.end(), lists[i].begin(), lists[i].end());
+    if (chunked) {
+      streams[i] = { &lists[i], 0, &gen, { 0 } };
+      src[i] = { NULL, 0, refill_chunk, &streams[i] };
+    } else {
+      src[i] = { lists[i].data(), lists[i].size(), NULL, NULL };
+    }
+  }
+  std::sort(all.begin(), all.end());
+
+  merge_cursor *c = merge_cursor_create(src.data(), k);
+  ASSERT_NE(nullptr, c);
+  size_t n;
+  while ((n = merge_cursor_next_batch(c, out.data(), batch)) > 0) {
+    ASSERT_LE(n, batch);
+    got.insert(got.end(), out.begin(), out.begin() + n);
+    if (got.size() < all.size()) {
+      ASSERT_EQ(batch, n) << "short batch before the end";
+    }
+  }
+  ASSERT_EQ(0u, merge_cursor_next_batch(c, out.data(), batch));
+  merge_cursor_destroy(c);
+  ASSERT_EQ(all, got) << "k = " << k << ", chunked " << chunked
+      << ", batch " << batch;
+}
+
+TEST(MergeCursorTest, FixedArrays)
+{
+  for (unsigned k = 0; k <= 9; ++k)
+    for (size_t batch : { 1, 7, 100, 5000 })
+      check_cursor(k, false, batch, 1000, k + batch);
+}
+
+TEST(MergeCursorTest, ChunkedSources)
+{
+  for (unsigned k = 1; k <= 9; ++k)
+    for (size_t batch : { 1, 7, 100, 5000 })
+      for (int max_val : { 3, 100000 })
+        check_cursor(k, true, batch, max_val, 31 * k + batch + max_val);
+}
@@ -0,0 +1,241 @@
+/* R. Fabbri, 2025 */
+#include <gtest/gtest.h>
+#include <string.h> // For memcmp
+#include <climits>
+#include <algorithm>
+#include <vector>
+#include <random>
+
+#include <sorted_merge_3way.h>
+#include <sorted_merge_kway.h>
+#include <merge_dispatch.h>
+#include <merge_stats.h>
+
+static const merge_kernel all_kernels[] = {
+  MERGE_KERNEL_BRANCHY, MERGE_KERNEL_BRANCHLESS,
+  MERGE_KERNEL_SSE41, MERGE_KERNEL_AVX2, MERGE_KERNEL_GALLOP
+};
+
+static std::vector<int>
+random_sorted(std::mt19937 &gen, size_t n, int lo, int hi)
+{
+  std::uniform_int_distribution<int> val(lo, hi);
+  std::vector<int> v(n);
+  for (int &x : v)
+    x = val(gen);
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+// Every kernel must match std::sort on the concatenation for 2 and 3 lists,
+// including lengths around the vector widths and heavy duplicates.
+static void
+check_kernel(merge_kernel k)
+{
+  std::mt19937 gen(7);
+  static const int ranges[][2] = {
+    { 0, 3 }, { -100, 100 }, { INT_MIN, INT_MAX }, { INT_MAX - 2, INT_MAX } };
+
+  for (int t = 0; t < 600; ++t) {
+    size_t cap = t < 500 ? 40 : 5000;
+    std::uniform_int_distribution<size_t> len(0, cap);
+    const int *rg = ranges[t % 4];
+    std::vector<int> a = random_sorted(gen, len(gen), rg[0], rg[1]);
+    std::vector<int> b = random_sorted(gen, len(gen), rg[0], rg[1]);
+    std::vector<int> c = random_sorted(gen, len(gen), rg[0], rg[1]);
+    std::vector<int> ab(a), abc;
+    ab.insert(ab.end(), b.begin(), b.end());
+    abc = ab;
+    abc.insert(abc.end(), c.begin(), c.end());
+    std::sort(ab.begin(), ab.end());
+    std::sort(abc.begin(), abc.end());
+
+    std::vector<int> out(abc.size() + 1, 0x5a5a5a5a);
+    ASSERT_TRUE(sorted_merge_3way(a.data(), a.size(), b.data(), b.size(),
+          c.data(), c.size(), out.data()));
+    ASSERT_EQ(0, memcmp(out.data(), abc.data(), abc.size() * sizeof(int)))
+        << "3-way mismatch, kernel " << k << ", trial " << t;
+    ASSERT_EQ(0x5a5a5a5a, out[abc.size()]);
+
+    out.assign(abc.size() + 1, 0x5a5a5a5a);
+    ASSERT_TRUE(sorted_merge_3way_fused(a.data(), a.size(), b.data(), b.size(),
+          c.data(), c.size(), out.data()));
+    ASSERT_EQ(0, memcmp(out.data(), abc.data(), abc.size() * sizeof(int)))
+        << "fused 3-way mismatch, kernel " << k << ", trial " << t;
+    ASSERT_EQ(0x5a5a5a5a, out[abc.size()]);
+
+    // any single inversion, wherever it lands, must fail the fused check
+    std::vector<int> *lists[3] = { &a, &b, &c };
+    std::vector<int> &l = *lists[t % 3];
+    if (l.size() >= 2) {
+      size_t i = std::uniform_int_distribution<size_t>(1, l.size() - 1)(gen);
+      if (l[i - 1] != l[i]) {
+        std::swap(l[i - 1], l[i]);
+        ASSERT_FALSE(sorted_merge_3way_fused(a.data(), a.size(),
+              b.data(), b.size(), c.data(), c.size(), out.data()))
+            << "missed inversion, kernel " << k << ", trial " << t;
+        std::swap(l[i - 1], l[i]);
+      }
+    }
+
+    merge_run runs[2] = { { a.data(), a.size() }, { b.data(), b.size() } };
+    out.assign(ab.size() + 1, 0x5a5a5a5a);
+    ASSERT_TRUE(sorted_merge_kway(runs, 2, out.data()));
+    ASSERT_EQ(0, memcmp(out.data(), ab.data(), ab.size() * sizeof(int)))
+        << "2-way mismatch, kernel " << k << ", trial " << t;
+    ASSERT_EQ(0x5a5a5a5a, out[ab.size()]);
+  }
+}
+
+// Lists made of runs of consecutive values, from fully interleaved (runs of
+// one) to disjoint, as seen with time-partitioned shards.
+static void
+check_runs(merge_kernel k)
+{
+  std::mt19937 gen(9);
+  static const size_t run_lens[] = { 1, 3, 8, 50, 1000, 100000 };
+
+  for (size_t rl : run_lens) {
+    for (int t = 0; t < 20; ++t) {
+      std::vector<int> l[3], all;
+      std::uniform_int_distribution<int> pick(0, 2);
+      size_t total = 3000 + 500 * t;
+      for (size_t v = 0; v < total; v += rl) {
+        int dst = pick(gen);
+        for (size_t j = v; j < v + rl && j < total; ++j)
+          l[dst].push_back(j / (t % 3 + 1));
+      }
+      for (int i = 0; i < 3; ++i)
+        all.insert(all.end(), l[i].begin(), l[i].end());
+      std::sort(all.begin(), all.end());
+      std::vector<int> out(all.size());
+
+      ASSERT_TRUE(sorted_merge_3way_fused(l[0].data(), l[0].size(),
+            l[1].data(), l[1].size(), l[2].data(), l[2].size(), out.data()));
+      ASSERT_EQ(all, out) << "kernel " << k << ", run length " << rl;
+      merge_run runs[2] = { { l[0].data(), l[0].size() }, { l[2].data(), l[2].size() } };
+      std::vector<int> ac(l[0]);
+      ac.insert(ac.end(), l[2].begin(), l[2].end());
+      std::sort(ac.begin(), ac.end());
+      out.assign(ac.size(), 0);
+      ASSERT_TRUE(sorted_merge_kway(runs, 2, out.data()));
+      ASSERT_EQ(ac, out) << "kernel " << k << ", run length " << rl;
+
+      std::vector<int> &m = l[t % 3];
+      if (m.size() > 2 && m[m.size() / 2] != m.back()) {
+        std::swap(m[m.size() / 2], m.back());
+        ASSERT_FALSE(sorted_merge_3way_fused(l[0].data(), l[0].size(),
+              l[1].data(), l[1].size(), l[2].data(), l[2].size(), out.data()))
+            << "missed inversion, kernel " << k << ", run length " << rl;
+      }
+    }
+  }
+}
+
+TEST(MergeKernelTest, AllKernelsAgree)
+{
+  for (merge_kernel k : all_kernels) {
+    if (!merge_set_kernel(k)) {
+      printf("kernel %d not supported here, skipped\n", k);
+      continue;
+    }
+    ASSERT_EQ(k, merge_get_kernel());
+    check_kernel(k);
+    check_runs(k);
+  }
+  ASSERT_TRUE(merge_set_kernel(MERGE_KERNEL_AUTO));
+  ASSERT_NE(MERGE_KERNEL_AUTO, merge_get_kernel());
+}
+
+// Streaming mode forced on for every size, with outputs at every alignment
+// within a cache line, against the normal path. Sizes cross several blocks.
+TEST(MergeKernelTest, StreamingStores)
+{
+  std::mt19937 gen(11);
+  size_t saved = merge_get_stream_threshold();
+  merge_set_stream_threshold(0);
+
+  for (int t = 0; t < 40; ++t) {
+    size_t cap = t < 20 ? 100 : 40000;
+    std::uniform_int_distribution<size_t> len(0, cap);
+    int hi = t % 2 ? 50 : INT_MAX;
+    std::vector<int> a = random_sorted(gen, len(gen), -hi, hi);
+    std::vector<int> b = random_sorted(gen, len(gen) / (t % 4 + 1), -hi, hi);
+    std::vector<int> c = random_sorted(gen, len(gen), 0, hi);
+    std::vector<int> abc(a);
+    abc.insert(abc.end(), b.begin(), b.end());
+    abc.insert(abc.end(), c.begin(), c.end());
+    std::sort(abc.begin(), abc.end());
+
+    size_t off = t % 16;
+    std::vector<int> buf(abc.size() + off + 1, 0x5a5a5a5a);
+    int *out = buf.data() + off;
+    sorted_merge_3way_trusted(a.data(), a.size(), b.data(), b.size(),
+        c.data(), c.size(), out);
+    ASSERT_EQ(0, memcmp(out, abc.data(), abc.size() * sizeof(int)))
+        << "trial " << t;
+    ASSERT_EQ(0x5a5a5a5a, out[abc.size()]);
+
+    std::fill(buf.begin(), buf.end(), 0);
+    ASSERT_TRUE(sorted_merge_3way_fused(a.data(), a.size(), b.data(), b.size(),
+          c.data(), c.size(), out));
+    ASSERT_EQ(0, memcmp(out, abc.data(), abc.size() * sizeof(int)))
+        << "fused, trial " << t;
+
+    if (a.size() >= 2 && a[a.size() / 3] != a.back()) {
+      std::swap(a[a.size() / 3], a.back());
+      ASSERT_FALSE(sorted_merge_3way_fused(a.data(), a.size(),
+            b.data(), b.size(), c.data(), c.size(), out))
+          << "missed inversion, trial " << t;
+      // unsorted input gives an unspecified result but must still finish
+      sorted_merge_3way_trusted(a.data(), a.size(), b.data(), b.size(),
+          c.data(), c.size(), out);
+    }
+  }
+  merge_set_stream_threshold(saved);
+}
+
+// Counters of the instrumented build (LIBMERGE_INSTRUMENT=ON); a normal build
+// must report zeros.
+TEST(MergeKernelTest, Stats)
+{
+  int a[] = { 1, 2, 3, 9 }, b[] = { 4, 5, 9 }, out[7];
+  merge_run runs[2] = { { a, 4 }, { b, 3 } };
+  merge_stats s;
+
+  ASSERT_TRUE(merge_set_kernel(MERGE_KERNEL_BRANCHY));
+  merge_stats_reset();
+  ASSERT_TRUE(sorted_merge_kway(runs, 2, out));
+  merge_stats_get(&s);
+  ASSERT_TRUE(merge_set_kernel(MERGE_KERNEL_AUTO));
+  if (!merge_stats_enabled()) {
+    ASSERT_EQ(0u, s.calls);
+    ASSERT_EQ(0u, s.comparisons);
+    return;
+  }
+
+  // runs 1 2 3 | 4 5 | 9 | 9, the tie going to a; the branchy kernel
+  // compares until a runs out, once per output
+  EXPECT_EQ(1u, s.calls);
+  EXPECT_EQ(6u, s.comparisons);
+  EXPECT_EQ(4u, s.outputs[0]);
+  EXPECT_EQ(3u, s.outputs[1]);
+  EXPECT_EQ(0u, s.outputs[2]);
+  EXPECT_EQ(4u, s.runs);
+  EXPECT_EQ(2u, s.run_len[0]);
+  EXPECT_EQ(2u, s.run_len[1]);
+
+  // disjoint lists are one run each whatever the kernel
+  std::vector<int> l(3000);
+  for (size_t i = 0; i < l.size(); ++i)
+    l[i] = i;
+  std::vector<int> o(l.size());
+  merge_stats_reset();
+  ASSERT_TRUE(sorted_merge_3way(l.data() + 2000, 1000, l.data(), 1000,
+        l.data() + 1000, 1000, o.data()));
+  merge_stats_get(&s);
+  EXPECT_EQ(l, o);
+  EXPECT_EQ(3u, s.runs);
+  EXPECT_EQ(3u, s.run_len[9]);
+  EXPECT_GT(s.comparisons, 0u);
+}
@@ -0,0 +1,69 @@
+/* R. Fabbri, 2025 */
+#include <gtest/gtest.h>
+#include <climits>
+#include <algorithm>
+#include <vector>
+#include <random>
+
+#include <merge_sort.h>
+
+static void
+check_sort(std::vector<int> v, unsigned nthreads)
+{
+  std::vector<int> want = v;
+  std::sort(want.begin(), want.end());
+  ASSERT_TRUE(merge_sort(v.data(), v.size(), nthreads));
+  ASSERT_EQ(want, v) << "n = " << v.size() << ", threads = " << nthreads;
+}
+
+TEST(MergeSortTest, Small)
+{
+  std::vector<int> v = { 5, INT_MIN, 3, INT_MAX, 3, -1, 0, INT_MAX, 7 };
+  check_sort(v, 1);
+  check_sort({}, 1);
+  check_sort({ 1 }, 1);
+}
+
+// Every size up to a few levels deep, so each split shape is covered.
+TEST(MergeSortTest, AllSmallSizes)
+{
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<int> val(-50, 50);
+  for (size_t n = 0; n <= 700; ++n) {
+    std::vector<int> v(n);
+    for (int &x : v)
+      x = val(gen);
+    check_sort(v, 1);
+  }
+}
+
+TEST(MergeSortTest, Patterns)
+{
+  size_t n = 100000;
+  std::vector<int> v(n);
+  for (size_t i = 0; i < n; ++i)
+    v[i] = i;
+  check_sort(v, 1);
+  std::reverse(v.begin(), v.end());
+  check_sort(v, 1);
+  std::fill(v.begin(), v.end(), 42);
+  check_sort(v, 1);
+}
+
+// Thread counts that do not divide into thirds evenly, on arrays large enough
+// that the parallel path runs.
+TEST(MergeSortTest, Threads)
+{
+  std::mt19937 gen(4);
+  std::uniform_int_distribution<int> val(INT_MIN, INT_MAX);
+  std::vector<int> v(1 << 20);
+  for (int &x : v)
+    x = val(gen);
+  for (unsigned t : { 0u, 2u, 3u, 4u, 5u, 7u, 16u })
+    check_sort(v, t);
+
+  std::vector<int> tmp(v.size()), want = v;
+  std::sort(want.begin(), want.end());
+  merge_sort_buf(v.data(), v.size(), tmp.data(), 4);
+  ASSERT_EQ(want, v);
+}
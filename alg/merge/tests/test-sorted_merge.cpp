@@ -0,0 +1,114 @@
+/* R. Fabbri, 2025 */
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include <random>
+
+#include <sorted_merge.hpp>
+
+// Merges N random sorted spans of T and compares with std::stable_sort of the
+// concatenation, which has the same tie order.
+template <class T, size_t N, class Compare = merge_less>
+static void
+check_typed(std::mt19937 &gen, int max_key, Compare cmp = Compare())
+{
+  std::uniform_int_distribution<size_t> len(0, 60);
+  std::uniform_int_distribution<int> key(-max_key, max_key);
+  std::vector<T> lists[N], all;
+  merge_span<T> in[N];
+
+  for (size_t i = 0; i < N; ++i) {
+    lists[i].resize(len(gen));
+    for (size_t j = 0; j < lists[i].size(); ++j)
+      lists[i][j] = T(key(gen));
+    std::sort(lists[i].begin(), lists[i].end(), cmp);
+    in[i] = { lists[i].data(), lists[i].size() };
+    all.insert(all.end(), lists[i].begin(), lists[i].end());
+  }
+  std::stable_sort(all.begin(), all.end(), cmp);
+  std::vector<T> out(all.size());
+
+  ASSERT_TRUE((sorted_merge<T, Compare, N>(in, out.data(), cmp)));
+  ASSERT_TRUE(std::equal(all.begin(), all.end(), out.begin())) << "N = " << N;
+}
+
+TEST(TypedMergeTest, ScalarTypes)
+{
+  std::mt19937 gen(11);
+  for (int t = 0; t < 100; ++t) {
+    check_typed<int64_t, 2>(gen, 50);
+    check_typed<int64_t, 3>(gen, 1 << 30);
+    check_typed<uint32_t, 3>(gen, 50);
+    check_typed<uint32_t, 5>(gen, 50);
+    check_typed<float, 1>(gen, 50);
+    check_typed<float, 3>(gen, 50);
+    check_typed<double, 4>(gen, 1000);
+    check_typed<double, 16>(gen, 5);
+    check_typed<int64_t, 3>(gen, 50, [](int64_t x, int64_t y) { return x > y; });
+  }
+}
+
+struct row {
+  int64_t key;
+  uint32_t id;
+  row() = default;
+  explicit row(int k) : key(k), id(0) { }
+};
+
+struct row_key {
+  int64_t operator()(const row &r) const { return r.key; }
+};
+
+// Records with duplicate keys keep their source order: input order first,
+// then position within each input.
+TEST(TypedMergeTest, StableRecords)
+{
+  std::mt19937 gen(5);
+  std::uniform_int_distribution<int> key(0, 4);
+
+  for (int t = 0; t < 200; ++t) {
+    std::vector<row> lists[7];
+    merge_span<row> in3[3], in7[7];
+    std::vector<row> all3, all7;
+    uint32_t id = 0;
+    for (int i = 0; i < 7; ++i) {
+      lists[i].resize(t % 30);
+      for (row &r : lists[i])
+        r.key = key(gen);
+      std::sort(lists[i].begin(), lists[i].end(),
+          merge_by_key<row_key>());
+      for (row &r : lists[i])
+        r.id = id++;
+      if (i < 3) {
+        in3[i] = { lists[i].data(), lists[i].size() };
+        all3.insert(all3.end(), lists[i].begin(), lists[i].end());
+      }
+      in7[i] = { lists[i].data(), lists[i].size() };
+      all7.insert(all7.end(), lists[i].begin(), lists[i].end());
+    }
+    std::stable_sort(all3.begin(), all3.end(), merge_by_key<row_key>());
+    std::stable_sort(all7.begin(), all7.end(), merge_by_key<row_key>());
+    std::vector<row> out3(all3.size()), out7(all7.size());
+
+    ASSERT_TRUE((sorted_merge<row, merge_by_key<row_key> >(in3, out3.data())));
+    sorted_merge_trusted<row, merge_by_key<row_key> >(in7, out7.data());
+    for (size_t i = 0; i < all3.size(); ++i)
+      ASSERT_EQ(all3[i].id, out3[i].id) << "3-way, position " << i;
+    for (size_t i = 0; i < all7.size(); ++i)
+      ASSERT_EQ(all7[i].id, out7[i].id) << "7-way, position " << i;
+  }
+}
+
+TEST(TypedMergeTest, UnsortedInput)
+{
+  double a[3] = { 0.5, 1.5, 1.25 };
+  double b[2] = { 0.0, 2.0 };
+  double out[5];
+  merge_span<double> in[2] = { { a, 3 }, { b, 2 } };
+
+  ASSERT_FALSE(sorted_merge(in, out));
+  a[2] = 3.0;
+  ASSERT_TRUE(sorted_merge(in, out));
+  ASSERT_EQ(3.0, out[4]);
+}
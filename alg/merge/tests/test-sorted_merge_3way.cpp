@@ -2,6 +2,15 @@
 #include <gtest/gtest.h>
 #include <string.h> // For memcmp
 #include <stdio.h>
+#include <climits>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <random>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include <sorted_merge_3way.h>
 
@@ -51,3 +60,189 @@ TEST(JuntaListasTest, UnsortedInput)
 
   ASSERT_FALSE(res) << "sorted_merge_3way returned true unexpectedly (input was unsorted).";
 }
+
+// Test case 3: INT_MAX is a valid key, not an end-of-list marker
+TEST(JuntaListasTest, IntMaxKeys)
+{
+  int a[2] = { 1, INT_MAX };
+  int b[1] = { INT_MAX };
+  int c[2] = { 2, INT_MAX };
+  int abc[2+1+2];
+  static const int abc_ground_truth[] = { 1, 2, INT_MAX, INT_MAX, INT_MAX };
+
+  bool res = sorted_merge_3way( a, 2, b, 1, c, 2, abc);
+
+  ASSERT_TRUE(res);
+  ASSERT_EQ(0, memcmp(abc, abc_ground_truth, (2+1+2) * sizeof(int)))
+      << "Merged array content mismatch.";
+}
+
+// Parallel merge must equal the serial one for any thread count, including
+// heavy duplicates where segment boundaries fall inside runs of equal keys.
+TEST(JuntaListasTest, ParallelMatchesSerial)
+{
+  static const int ranges[] = { 3, 1000, 1 << 30 };
+  size_t na = 200000, nb = 150001, nc = 90007;
+  int *a = new int[na], *b = new int[nb], *c = new int[nc];
+  int *ser = new int[na + nb + nc], *par = new int[na + nb + nc];
+  unsigned seed = 1;
+
+  for (int range : ranges) {
+    for (size_t i = 0; i < na; ++i) a[i] = (seed = seed * 1103515245 + 12345) % range;
+    for (size_t i = 0; i < nb; ++i) b[i] = (seed = seed * 1103515245 + 12345) % range;
+    for (size_t i = 0; i < nc; ++i) c[i] = (seed = seed * 1103515245 + 12345) % range;
+    std::sort(a, a + na);
+    std::sort(b, b + nb);
+    std::sort(c, c + nc);
+    ASSERT_TRUE(sorted_merge_3way(a, na, b, nb, c, nc, ser));
+    for (unsigned t = 0; t <= 8; ++t) {
+      memset(par, 0, (na + nb + nc) * sizeof(int));
+      ASSERT_TRUE(sorted_merge_3way_parallel(a, na, b, nb, c, nc, par, t));
+      ASSERT_EQ(0, memcmp(ser, par, (na + nb + nc) * sizeof(int)))
+          << "threads " << t << ", range " << range;
+    }
+  }
+
+  // an inversion right at a slice boundary must still be caught
+  std::swap(b[nb / 4 - 1], b[nb / 4]);
+  b[nb / 4 - 1] = b[nb / 4] + 1;
+  ASSERT_FALSE(sorted_merge_3way_parallel(a, na, b, nb, c, nc, par, 4));
+
+  delete [] a; delete [] b; delete [] c;
+  delete [] ser; delete [] par;
+}
+
+// Fused check: valid input merges like sorted_merge_3way, and an inversion
+// anywhere in any list is reported, whichever merge phase meets it.
+TEST(JuntaListasTest, FusedCheck)
+{
+  int a[3] = { 3, 6, 11 };
+  int b[4] = { 4, 16, 21, 25 };
+  int c[2] = { 1, 10 };
+  int abc[3+4+2];
+  static const int abc_ground_truth[] = { 1, 3, 4, 6, 10, 11, 16, 21, 25 };
+
+  ASSERT_TRUE(sorted_merge_3way_fused(a, 3, b, 4, c, 2, abc));
+  ASSERT_EQ(0, memcmp(abc, abc_ground_truth, (3+4+2) * sizeof(int)));
+  memset(abc, 0, sizeof(abc));
+  sorted_merge_3way_trusted(a, 3, b, 4, c, 2, abc);
+  ASSERT_EQ(0, memcmp(abc, abc_ground_truth, (3+4+2) * sizeof(int)));
+  ASSERT_TRUE(sorted_merge_3way_fused(a, 0, b, 0, c, 0, abc));
+
+  int *lists[3] = { a, b, c };
+  int lens[3] = { 3, 4, 2 };
+  for (int l = 0; l < 3; ++l) {
+    for (int i = 0; i + 1 < lens[l]; ++i) {
+      std::swap(lists[l][i], lists[l][i + 1]);
+      ASSERT_FALSE(sorted_merge_3way_fused(a, 3, b, 4, c, 2, abc))
+          << "list " << l << ", position " << i;
+      ASSERT_FALSE(sorted_merge_3way(a, 3, b, 4, c, 2, abc));
+      std::swap(lists[l][i], lists[l][i + 1]);
+    }
+  }
+
+  // inversion in the block-copied tail, after the other lists ran dry
+  int d[5] = { 100, 200, 300, 250, 400 };
+  ASSERT_FALSE(sorted_merge_3way_fused(a, 3, d, 5, c, 2, abc));
+}
+
+// Lengths whose total would not fit in memory are refused before any read;
+// the pointers are never dereferenced.
+TEST(JuntaListasTest, Size64Overflow)
+{
+  int a[1] = { 1 }, abc[1];
+
+  ASSERT_FALSE(sorted_merge_3way64(a, SIZE_MAX, a, 1, a, 1, abc));
+  ASSERT_FALSE(sorted_merge_3way64(a, SIZE_MAX / 8, a, SIZE_MAX / 8, a,
+      SIZE_MAX / 8, abc));
+  ASSERT_FALSE(sorted_merge_3way(a, -1, a, 1, a, 1, abc));
+  ASSERT_TRUE(sorted_merge_3way64(a, 1, a, 0, a, 0, abc));
+  ASSERT_FALSE(sorted_merge_3way_parallel(a, SIZE_MAX, a, 1, a, 1, abc, 4));
+  ASSERT_FALSE(sorted_merge_3way_parallel(a, SIZE_MAX / 8, a, SIZE_MAX / 8,
+      a, SIZE_MAX / 8, abc, 4));
+  ASSERT_TRUE(sorted_merge_3way_parallel(a, 1, a, 0, a, 0, abc, 4));
+}
+
+// Merges 2^31 + 16 elements, so output positions no longer fit in an int.
+// list_a is an anonymous read-only mapping that reads as zeros without using
+// memory; the 8 GB output is a sparse file mapped in the directory named by
+// MERGE_TEST_LARGE, which needs that much free disk. Skipped when unset.
+TEST(JuntaListasTest, Over2GElements)
+{
+  const char *dir = getenv("MERGE_TEST_LARGE");
+  if (!dir)
+    GTEST_SKIP() << "set MERGE_TEST_LARGE to a scratch directory to run";
+
+  size_t na = ((size_t) 1 << 31) + 16, total = na + 5;
+  int b[2] = { -2, -1 }, c[3] = { 1, 2, 3 };
+  int *a = (int *) mmap(NULL, na * sizeof(int), PROT_READ,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  ASSERT_NE(MAP_FAILED, (void *) a);
+
+  std::string path = std::string(dir) + "/merge-test-XXXXXX";
+  int fd = mkstemp(&path[0]);
+  ASSERT_GE(fd, 0) << path;
+  unlink(path.c_str());
+  ASSERT_EQ(0, ftruncate(fd, total * sizeof(int)));
+  int *abc = (int *) mmap(NULL, total * sizeof(int), PROT_READ | PROT_WRITE,
+      MAP_SHARED, fd, 0);
+  close(fd);
+  ASSERT_NE(MAP_FAILED, (void *) abc);
+
+  ASSERT_TRUE(sorted_merge_3way64(a, na, b, 2, c, 3, abc));
+  EXPECT_EQ(-2, abc[0]);
+  EXPECT_EQ(-1, abc[1]);
+  EXPECT_EQ(0, abc[2]);
+  EXPECT_EQ(0, abc[((size_t) 1 << 31) + 1]);
+  EXPECT_EQ(0, abc[na + 1]);
+  EXPECT_EQ(1, abc[na + 2]);
+  EXPECT_EQ(2, abc[na + 3]);
+  EXPECT_EQ(3, abc[na + 4]);
+
+  munmap(abc, total * sizeof(int));
+  munmap(a, na * sizeof(int));
+}
+
+// Top-k and rank against the full merge, for every k and r on small lists
+// and spot checks on larger ones with heavy duplicates.
+TEST(JuntaListasTest, TopkAndRank)
+{
+  std::mt19937 gen(12);
+  for (int t = 0; t < 60; ++t) {
+    size_t cap = t < 50 ? 30 : 3000;
+    int range = t % 3 ? 10 : INT_MAX;
+    std::uniform_int_distribution<size_t> len(0, cap);
+    std::uniform_int_distribution<int> val(-range, range);
+    std::vector<int> l[3];
+    for (auto &v : l) {
+      v.resize(len(gen));
+      for (int &x : v)
+        x = val(gen);
+      std::sort(v.begin(), v.end());
+    }
+    size_t total = l[0].size() + l[1].size() + l[2].size();
+    std::vector<int> all(total + 1);
+    sorted_merge_3way_trusted(l[0].data(), l[0].size(), l[1].data(),
+        l[1].size(), l[2].data(), l[2].size(), all.data());
+
+    size_t step = total > 100 ? total / 37 : 1;
+    for (size_t k = 0; k <= total + 1; k += step) {
+      std::vector<int> out(k + 1, 0x5a5a5a5a);
+      size_t m = std::min(k, total);
+      ASSERT_EQ(m, sorted_merge_topk(l[0].data(), l[0].size(), l[1].data(),
+            l[1].size(), l[2].data(), l[2].size(), k, out.data()));
+      ASSERT_TRUE(std::equal(all.begin(), all.begin() + m, out.begin()))
+          << "k = " << k;
+      ASSERT_EQ(0x5a5a5a5a, out[m]);
+
+      int v = 0x5a5a5a5a;
+      bool in_range = k < total;
+      ASSERT_EQ(in_range, sorted_merge_rank(l[0].data(), l[0].size(),
+            l[1].data(), l[1].size(), l[2].data(), l[2].size(), k, &v));
+      if (in_range)
+        ASSERT_EQ(all[k], v) << "rank " << k;
+      else
+        ASSERT_EQ(0x5a5a5a5a, v);
+    }
+  }
+}
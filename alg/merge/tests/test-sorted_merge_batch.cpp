@@ -0,0 +1,99 @@
+/* R. Fabbri, 2025 */
+#include <gtest/gtest.h>
+#include <climits>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <random>
+
+#include <sorted_merge_batch.h>
+
+// Builds `count` merges with list lengths drawn from 0..max_len each, runs
+// them as one batch and compares every output with std::sort.
+static void
+check_batch(size_t count, unsigned max_len, unsigned nthreads, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<unsigned> len(0, max_len);
+  std::uniform_int_distribution<int> val(-20, 20);
+  std::vector<std::vector<int>> in(3 * count), out(count), want(count);
+  std::vector<const int *> p[3];
+  std::vector<size_t> n[3];
+  std::vector<int *> po(count);
+
+  for (int l = 0; l < 3; ++l) {
+    p[l].resize(count);
+    n[l].resize(count);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    for (int l = 0; l < 3; ++l) {
+      std::vector<int> &v = in[3 * i + l];
+      v.resize(len(gen));
+      for (int &x : v)
+        x = i % 7 ? val(gen) : (int) gen();
+      std::sort(v.begin(), v.end());
+      p[l][i] = v.data();
+      n[l][i] = v.size();
+      want[i].insert(want[i].end(), v.begin(), v.end());
+    }
+    std::sort(want[i].begin(), want[i].end());
+    out[i].assign(want[i].size() + 1, 0x5a5a5a5a);
+    po[i] = out[i].data();
+  }
+  merge3_batch mb = { p[0].data(), n[0].data(), p[1].data(), n[1].data(),
+      p[2].data(), n[2].data(), po.data(), count };
+
+  std::unique_ptr<bool[]> ok(new bool[count + 1]());
+  ASSERT_TRUE(sorted_merge_3way_batch(&mb, ok.get(), nthreads));
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_TRUE(ok[i]) << "merge " << i;
+    ASSERT_TRUE(std::equal(want[i].begin(), want[i].end(), out[i].begin()))
+        << "merge " << i;
+    ASSERT_EQ(0x5a5a5a5a, out[i].back()) << "wrote past merge " << i;
+  }
+  ASSERT_TRUE(sorted_merge_3way_batch(&mb, NULL, nthreads));
+  for (size_t i = 0; i < count; ++i)
+    ASSERT_TRUE(std::equal(want[i].begin(), want[i].end(), out[i].begin()))
+        << "merge " << i;
+}
+
+TEST(BatchMergeTest, Tiny)
+{
+  check_batch(2000, 6, 1, 1);
+}
+
+TEST(BatchMergeTest, AcrossPaths)
+{
+  check_batch(300, 40, 1, 2);
+  check_batch(20, 400, 1, 3);
+  check_batch(0, 4, 1, 4);
+}
+
+TEST(BatchMergeTest, Threads)
+{
+  for (unsigned t : { 0u, 2u, 3u, 8u })
+    check_batch(20000, 8, t, 5 + t);
+}
+
+TEST(BatchMergeTest, UnsortedEntry)
+{
+  int a[3] = { 1, 5, 9 }, b[2] = { 2, 3 }, c[2] = { 8, 4 };
+  int big[100];
+  for (int i = 0; i < 100; ++i)
+    big[i] = i;
+  int o0[7], o1[7], o2[102];
+  const int *pa[3] = { a, a, big }, *pb[3] = { b, b, b }, *pc[3] = { a, c, a };
+  size_t na[3] = { 3, 3, 100 }, nb[3] = { 2, 2, 2 }, nc[3] = { 2, 2, 0 };
+  int *po[3] = { o0, o1, o2 };
+  merge3_batch mb = { pa, na, pb, nb, pc, nc, po, 3 };
+  bool ok[3];
+
+  ASSERT_FALSE(sorted_merge_3way_batch(&mb, ok, 1));
+  ASSERT_TRUE(ok[0]);
+  ASSERT_FALSE(ok[1]);
+  ASSERT_TRUE(ok[2]);
+
+  big[50] = -1;
+  ASSERT_FALSE(sorted_merge_3way_batch(&mb, ok, 1));
+  ASSERT_FALSE(ok[2]);
+}
@@ -0,0 +1,111 @@
+/* R. Fabbri, 2025 */
+#include <gtest/gtest.h>
+#include <string.h> // For memcmp
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <random>
+
+#include <sorted_merge_files.h>
+
+// Temporary files removed at the end of each test.
+class MergeFilesTest : public ::testing::Test {
+protected:
+  std::string
+  make_file(const void *data, size_t bytes)
+  {
+    char path[] = "/tmp/test-merge-files-XXXXXX";
+    int fd = mkstemp(path);
+    EXPECT_GE(fd, 0);
+    EXPECT_EQ((ssize_t) bytes, write(fd, data, bytes));
+    close(fd);
+    paths.push_back(path);
+    return path;
+  }
+
+  std::vector<int>
+  read_file(const std::string &path)
+  {
+    std::vector<int> v;
+    FILE *f = fopen(path.c_str(), "rb");
+    int x;
+    while (f && fread(&x, sizeof(int), 1, f) == 1)
+      v.push_back(x);
+    if (f)
+      fclose(f);
+    return v;
+  }
+
+  void
+  TearDown() override
+  {
+    for (const std::string &p : paths)
+      unlink(p.c_str());
+  }
+
+  std::vector<std::string> paths;
+};
+
+TEST_F(MergeFilesTest, MergesAcrossBufferBoundaries)
+{
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<int> val(-50, 50);
+  std::vector<int> all;
+  std::vector<const char *> in;
+  std::vector<std::string> names;
+
+  for (unsigned i = 0; i < 7; ++i) {
+    std::vector<int> v(i == 2 ? 0 : 500 + 997 * i);
+    for (int &x : v)
+      x = val(gen);
+    std::sort(v.begin(), v.end());
+    all.insert(all.end(), v.begin(), v.end());
+    names.push_back(make_file(v.data(), v.size() * sizeof(int)));
+  }
+  for (const std::string &s : names)
+    in.push_back(s.c_str());
+  std::sort(all.begin(), all.end());
+  std::string out = make_file("", 0);
+
+  for (unsigned k = 1; k <= 7; k += 2) {
+    std::vector<int> expect;
+    for (unsigned i = 0; i < k; ++i) {
+      std::vector<int> v = read_file(names[i]);
+      expect.insert(expect.end(), v.begin(), v.end());
+    }
+    std::sort(expect.begin(), expect.end());
+    for (int overlap = 0; overlap < 2; ++overlap) {
+      merge_file_opts opts = { 1000, overlap != 0, true };
+      ASSERT_EQ(MERGE_FILE_OK, sorted_merge_files(in.data(), k, out.c_str(), &opts));
+      ASSERT_EQ(expect, read_file(out)) << "k = " << k << ", overlap " << overlap;
+    }
+  }
+  ASSERT_EQ(MERGE_FILE_OK, sorted_merge_files(in.data(), 7, out.c_str(), NULL));
+  ASSERT_EQ(all, read_file(out));
+}
+
+TEST_F(MergeFilesTest, Errors)
+{
+  int sorted[4] = { 1, 2, 3, 4 };
+  int unsorted[4] = { 1, 3, 2, 4 };
+  std::string a = make_file(sorted, sizeof(sorted));
+  std::string b = make_file(unsorted, sizeof(unsorted));
+  std::string odd = make_file(sorted, 7);
+  std::string out = make_file("", 0);
+  const char *in[2] = { a.c_str(), b.c_str() };
+  merge_file_opts opts = { 2, false, true };
+
+  ASSERT_EQ(MERGE_FILE_UNSORTED, sorted_merge_files(in, 2, out.c_str(), &opts));
+  in[1] = odd.c_str();
+  ASSERT_EQ(MERGE_FILE_FORMAT, sorted_merge_files(in, 2, out.c_str(), &opts));
+  in[1] = "/nonexistent/test-merge-files";
+  ASSERT_EQ(MERGE_FILE_IO, sorted_merge_files(in, 2, out.c_str(), &opts));
+  ASSERT_EQ(MERGE_FILE_OK, sorted_merge_files(in, 0, out.c_str(), &opts));
+  ASSERT_TRUE(read_file(out).empty());
+  // a buffer whose size in bytes wraps around
+  opts = { SIZE_MAX / 8 + 1, true, false };
+  ASSERT_EQ(MERGE_FILE_NOMEM, sorted_merge_files(in, 1, out.c_str(), &opts));
+}
@@ -0,0 +1,99 @@
+/* R. Fabbri, 2025 */
+#include <gtest/gtest.h>
+#include <climits>
+#include <algorithm>
+#include <vector>
+#include <random>
+
+#include <sorted_merge_inplace.h>
+
+// Three runs of the given lengths, sorted separately and laid out back to
+// back, merged in place with `nbuf` ints of scratch and compared with
+// std::sort. A guard after the array must stay untouched.
+static void
+check_inplace(std::mt19937 &gen, size_t na, size_t nb, size_t nc,
+    int lo, int hi, size_t nbuf)
+{
+  std::uniform_int_distribution<int> val(lo, hi);
+  size_t n = na + nb + nc;
+  std::vector<int> v(n + 1, 0x5a5a5a5a);
+  for (size_t i = 0; i < n; ++i)
+    v[i] = val(gen);
+  std::sort(v.begin(), v.begin() + na);
+  std::sort(v.begin() + na, v.begin() + na + nb);
+  std::sort(v.begin() + na + nb, v.begin() + n);
+  std::vector<int> want(v.begin(), v.begin() + n);
+  std::sort(want.begin(), want.end());
+
+  std::vector<int> buf(nbuf + 1);
+  sorted_merge_3way_inplace_buf(v.data(), na, nb, nc, buf.data(), nbuf);
+  ASSERT_TRUE(std::equal(want.begin(), want.end(), v.begin()))
+      << na << " " << nb << " " << nc << ", scratch " << nbuf;
+  ASSERT_EQ(0x5a5a5a5a, v[n]);
+}
+
+TEST(InplaceMergeTest, SmallSizes)
+{
+  std::mt19937 gen(5);
+  static const size_t scratch[] = { 0, 1, 3, 16 };
+  for (size_t na = 0; na <= 12; ++na)
+    for (size_t nb = 0; nb <= 12; ++nb)
+      for (size_t nc = 0; nc <= 12; ++nc)
+        for (size_t s : scratch)
+          check_inplace(gen, na, nb, nc, -5, 5, s);
+}
+
+// Lopsided lengths, wide and narrow value ranges, and scratch buffers from
+// none to larger than the input.
+TEST(InplaceMergeTest, Random)
+{
+  std::mt19937 gen(6);
+  std::uniform_int_distribution<size_t> len(0, 20000);
+  static const size_t scratch[] = { 0, 7, 141, 1024, 100000 };
+  for (int t = 0; t < 60; ++t) {
+    size_t na = len(gen), nb = len(gen) / (t % 5 + 1), nc = len(gen) % 3000;
+    int hi = t % 3 ? INT_MAX : 10;
+    check_inplace(gen, na, nb, nc, t % 2 ? INT_MIN : 0, hi, scratch[t % 5]);
+  }
+}
+
+TEST(InplaceMergeTest, Patterns)
+{
+  size_t n = 30000;
+  std::vector<int> v(n), want(n);
+  for (size_t i = 0; i < n; ++i)
+    want[i] = i;
+
+  // runs that are already in order, and in reverse order of each other
+  v = want;
+  ASSERT_TRUE(sorted_merge_3way_inplace(v.data(), 10000, 10000, 10000));
+  ASSERT_EQ(want, v);
+  for (size_t i = 0; i < n; ++i)
+    v[i] = (i / 10000 == 0 ? 20000 : i / 10000 == 2 ? -20000 : 0) + i % 10000;
+  want = v;
+  std::sort(want.begin(), want.end());
+  ASSERT_TRUE(sorted_merge_3way_inplace(v.data(), 10000, 10000, 10000));
+  ASSERT_EQ(want, v);
+
+  // interleaved by value: a gets 3i, b 3i + 1, c 3i + 2
+  for (size_t i = 0; i < n; ++i)
+    v[i] = 3 * (i % 10000) + i / 10000;
+  ASSERT_TRUE(sorted_merge_3way_inplace(v.data(), 10000, 10000, 10000));
+  for (size_t i = 0; i < n; ++i)
+    ASSERT_EQ((int) i, v[i]);
+
+  std::fill(v.begin(), v.end(), 7);
+  ASSERT_TRUE(sorted_merge_3way_inplace(v.data(), 1, n - 2, 1));
+  ASSERT_TRUE(std::all_of(v.begin(), v.end(), [](int x) { return x == 7; }));
+}
+
+TEST(InplaceMergeTest, Unsorted)
+{
+  std::vector<int> v = { 1, 3, 2, 0, 5, 4, 6 }, orig = v;
+  ASSERT_FALSE(sorted_merge_3way_inplace(v.data(), 2, 1, 4));
+  ASSERT_EQ(orig, v);
+  ASSERT_FALSE(sorted_merge_3way_inplace(v.data(), 3, 2, 2));
+  ASSERT_EQ(orig, v);
+  ASSERT_TRUE(sorted_merge_3way_inplace(v.data(), 2, 1, 0));
+  ASSERT_TRUE(sorted_merge_3way_inplace(v.data(), 0, 0, 0));
+}
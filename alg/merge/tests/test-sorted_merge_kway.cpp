@@ -0,0 +1,103 @@
+/* R. Fabbri, 2025 */
+#include <gtest/gtest.h>
+#include <string.h> // For memcmp
+#include <stdlib.h>
+#include <climits>
+#include <algorithm>
+#include <vector>
+#include <random>
+
+#include <sorted_merge_kway.h>
+
+// Builds k sorted runs of random lengths and merges them, checking against
+// std::sort on the concatenation.
+static void
+check_random_kway(unsigned k, unsigned max_len, int max_val, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<unsigned> len(0, max_len);
+  std::uniform_int_distribution<int> val(-max_val, max_val);
+  std::vector<std::vector<int>> lists(k);
+  std::vector<merge_run> runs(k);
+  std::vector<int> all;
+
+  for (unsigned i = 0; i < k; ++i) {
+    lists[i].resize(len(gen));
+    for (int &v : lists[i])
+      v = val(gen);
+    std::sort(lists[i].begin(), lists[i].end());
+    runs[i].data = lists[i].data();
+    runs[i].n = lists[i].size();
+    all.insert(all.end(), lists[i].begin(), lists[i].end());
+  }
+  std::sort(all.begin(), all.end());
+  std::vector<int> out(all.size() + 1, 0x5a5a5a5a);
+
+  ASSERT_TRUE(sorted_merge_kway(runs.data(), k, out.data())) << "k = " << k;
+  ASSERT_EQ(0, memcmp(out.data(), all.data(), all.size() * sizeof(int)))
+      << "Merged array content mismatch for k = " << k;
+  ASSERT_EQ(0x5a5a5a5a, out[all.size()]) << "Wrote past the end, k = " << k;
+}
+
+TEST(KwayMergeTest, ValidMerge)
+{
+  int a[3] = { 3, 6, 11 };
+  int b[4] = { 4, 16, 21, 25 };
+  int c[2] = { 1, 10 };
+  int d[1] = { 7 };
+  merge_run runs[4] = { { a, 3 }, { b, 4 }, { c, 2 }, { d, 1 } };
+  int abcd[3+4+2+1];
+  static const int abcd_ground_truth[] = { 1, 3, 4, 6, 7, 10, 11, 16, 21, 25 };
+
+  ASSERT_TRUE(sorted_merge_kway(runs, 4, abcd));
+  ASSERT_EQ(0, memcmp(abcd, abcd_ground_truth, sizeof(abcd_ground_truth)));
+}
+
+TEST(KwayMergeTest, UnsortedInput)
+{
+  int a[3] = { 3, 6, 11 };
+  int b[4] = { 4, 16, 21, 25 };
+  int c[2] = { 11, 10 }; // This list is unsorted
+  int d[1] = { 7 };
+  merge_run runs[4] = { { a, 3 }, { b, 4 }, { c, 2 }, { d, 1 } };
+  int abcd[3+4+2+1];
+
+  ASSERT_FALSE(sorted_merge_kway(runs, 4, abcd));
+}
+
+TEST(KwayMergeTest, ExtremeValues)
+{
+  int a[3] = { INT_MIN, 0, INT_MAX };
+  int b[2] = { INT_MAX, INT_MAX };
+  int c[1] = { INT_MIN };
+  int d[2] = { -1, INT_MAX };
+  int e[1] = { INT_MAX };
+  merge_run runs[5] = { { a, 3 }, { b, 2 }, { c, 1 }, { d, 2 }, { e, 1 } };
+  int out[9];
+  static const int ground_truth[] = {
+    INT_MIN, INT_MIN, -1, 0, INT_MAX, INT_MAX, INT_MAX, INT_MAX, INT_MAX };
+
+  ASSERT_TRUE(sorted_merge_kway(runs, 5, out));
+  ASSERT_EQ(0, memcmp(out, ground_truth, sizeof(ground_truth)));
+}
+
+TEST(KwayMergeTest, EmptyRuns)
+{
+  int a[2] = { 2, 5 };
+  merge_run runs[4] = { { NULL, 0 }, { a, 2 }, { NULL, 0 }, { NULL, 0 } };
+  int out[2];
+
+  ASSERT_TRUE(sorted_merge_kway(runs, 0, out));
+  ASSERT_TRUE(sorted_merge_kway(runs, 4, out));
+  ASSERT_EQ(2, out[0]);
+  ASSERT_EQ(5, out[1]);
+}
+
+TEST(KwayMergeTest, RandomRuns)
+{
+  for (unsigned k = 1; k <= 40; ++k)
+    check_random_kway(k, 50, 100, k);
+  check_random_kway(255, 100, 1000000, 1);
+  check_random_kway(256, 100, 5, 2);
+  check_random_kway(257, 100, 1000000, 3);
+}
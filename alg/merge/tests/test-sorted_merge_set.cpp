@@ -0,0 +1,156 @@
+/* R. Fabbri, 2025 */
+#include <gtest/gtest.h>
+#include <climits>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+#include <random>
+
+#include <sorted_merge_set.h>
+
+// Reference: for each distinct value, the number of lists holding it.
+static std::map<int, unsigned>
+list_counts(const std::vector<std::vector<int>> &lists)
+{
+  std::map<int, unsigned> cnt;
+  for (const auto &l : lists)
+    for (int v : std::set<int>(l.begin(), l.end()))
+      cnt[v]++;
+  return cnt;
+}
+
+static std::vector<int>
+at_least(const std::vector<std::vector<int>> &lists, unsigned m)
+{
+  std::vector<int> r;
+  for (const auto &p : list_counts(lists))
+    if (p.second >= std::max(m, 1u))
+      r.push_back(p.first);
+  return r;
+}
+
+static std::vector<int>
+minus_rest(const std::vector<std::vector<int>> &lists)
+{
+  std::vector<int> r;
+  if (lists.empty())
+    return r;
+  std::set<int> rest;
+  for (size_t i = 1; i < lists.size(); ++i)
+    rest.insert(lists[i].begin(), lists[i].end());
+  for (int v : std::set<int>(lists[0].begin(), lists[0].end()))
+    if (!rest.count(v))
+      r.push_back(v);
+  return r;
+}
+
+static std::vector<std::vector<int>>
+random_lists(std::mt19937 &gen, unsigned k, unsigned max_len, int max_val)
+{
+  std::uniform_int_distribution<unsigned> len(0, max_len);
+  std::uniform_int_distribution<int> val(-max_val, max_val);
+  std::vector<std::vector<int>> lists(k);
+  for (auto &l : lists) {
+    l.resize(len(gen));
+    for (int &v : l)
+      v = val(gen);
+    std::sort(l.begin(), l.end());
+  }
+  return lists;
+}
+
+static size_t
+total(const std::vector<std::vector<int>> &lists)
+{
+  size_t n = 0;
+  for (const auto &l : lists)
+    n += l.size();
+  return n;
+}
+
+static void
+expect_out(const std::vector<int> &want, const std::vector<int> &out, size_t n,
+    const char *what)
+{
+  ASSERT_EQ(want.size(), n) << what;
+  for (size_t i = 0; i < n; ++i)
+    ASSERT_EQ(want[i], out[i]) << what << " at " << i;
+}
+
+static void
+check_3way(const std::vector<std::vector<int>> &l)
+{
+  std::vector<int> out(total(l) + 1);
+  const int *a = l[0].data(), *b = l[1].data(), *c = l[2].data();
+  size_t na = l[0].size(), nb = l[1].size(), nc = l[2].size();
+
+  expect_out(at_least(l, 1), out,
+      sorted_union_3way(a, na, b, nb, c, nc, out.data()), "union");
+  expect_out(at_least(l, 3), out,
+      sorted_intersect_3way(a, na, b, nb, c, nc, out.data()), "intersect");
+  for (unsigned m = 0; m <= 4; ++m)
+    expect_out(at_least(l, m), out,
+        sorted_threshold_3way(a, na, b, nb, c, nc, m, out.data()),
+        "threshold");
+  expect_out(minus_rest(l), out,
+      sorted_difference_3way(a, na, b, nb, c, nc, out.data()), "difference");
+}
+
+static void
+check_kway(const std::vector<std::vector<int>> &l)
+{
+  unsigned k = l.size();
+  std::vector<merge_run> runs(k);
+  std::vector<int> out(total(l) + 1);
+  for (unsigned i = 0; i < k; ++i)
+    runs[i] = { l[i].data(), l[i].size() };
+
+  expect_out(at_least(l, 1), out,
+      sorted_union_kway(runs.data(), k, out.data()), "union");
+  expect_out(k ? at_least(l, k) : std::vector<int>(), out,
+      sorted_intersect_kway(runs.data(), k, out.data()), "intersect");
+  for (unsigned m = 0; m <= k + 1; ++m)
+    expect_out(m <= k ? at_least(l, m) : std::vector<int>(), out,
+        sorted_threshold_kway(runs.data(), k, m, out.data()), "threshold");
+  expect_out(minus_rest(l), out,
+      sorted_difference_kway(runs.data(), k, out.data()), "difference");
+}
+
+TEST(SortedMergeSetTest, Small3way) {
+  check_3way({{1, 1, 3, 5}, {1, 3, 3, 4}, {0, 3, 5, 5, 9}});
+  check_3way({{}, {}, {}});
+  check_3way({{2, 2, 2}, {}, {2}});
+  check_3way({{INT_MIN, INT_MAX}, {INT_MAX}, {INT_MIN, INT_MAX, INT_MAX}});
+}
+
+TEST(SortedMergeSetTest, Random3way) {
+  std::mt19937 gen(9);
+  for (int iter = 0; iter < 300; ++iter) {
+    check_3way(random_lists(gen, 3, 40, 30));
+    check_3way(random_lists(gen, 3, 200, 100000));
+  }
+}
+
+// Sizes far apart exercise the exponential search in intersection and
+// difference.
+TEST(SortedMergeSetTest, Skewed3way) {
+  std::mt19937 gen(10);
+  for (int iter = 0; iter < 20; ++iter) {
+    auto l = random_lists(gen, 3, 5, 1000);
+    l[1] = random_lists(gen, 1, 5000, 1000)[0];
+    check_3way(l);
+    std::swap(l[0], l[1]);
+    check_3way(l);
+  }
+}
+
+TEST(SortedMergeSetTest, RandomKway) {
+  std::mt19937 gen(11);
+  for (unsigned k = 0; k <= 10; ++k)
+    for (int iter = 0; iter < 30; ++iter) {
+      check_kway(random_lists(gen, k, 30, 20));
+      check_kway(random_lists(gen, k, 100, 1000));
+    }
+  check_kway(random_lists(gen, 100, 50, 60));
+}
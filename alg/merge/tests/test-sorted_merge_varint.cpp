@@ -0,0 +1,88 @@
+/* R. Fabbri, 2025 */
+#include <gtest/gtest.h>
+#include <climits>
+#include <algorithm>
+#include <vector>
+#include <random>
+
+#include <sorted_merge_varint.h>
+
+// Sorted values whose gaps are drawn from 0..max_gap, starting at lo, so
+// small gaps exercise the one-byte fast path and large ones every length.
+static std::vector<int>
+random_gaps(std::mt19937 &gen, size_t n, int lo, uint32_t max_gap)
+{
+  std::uniform_int_distribution<uint32_t> gap(0, max_gap);
+  std::vector<int> v(n);
+  int64_t x = lo;
+  for (size_t i = 0; i < n; ++i) {
+    x = std::min<int64_t>(x + gap(gen), INT_MAX);
+    v[i] = (int) x;
+  }
+  return v;
+}
+
+static std::vector<unsigned char>
+encode(const std::vector<int> &v)
+{
+  std::vector<unsigned char> e(VARINT_MAX_BYTES(v.size()));
+  e.resize(varint_encode(v.data(), v.size(), e.data()));
+  return e;
+}
+
+TEST(VarintMergeTest, RoundTrip)
+{
+  std::mt19937 gen(8);
+  static const uint32_t gaps[] = { 0, 1, 100, 127, 128, 20000, 1u << 30 };
+
+  for (int t = 0; t < 70; ++t) {
+    size_t n = std::uniform_int_distribution<size_t>(0, t < 35 ? 40 : 5000)(gen);
+    std::vector<int> v = random_gaps(gen, n, t % 2 ? INT_MIN : -1000, gaps[t % 7]);
+    std::vector<unsigned char> e = encode(v);
+    varint_list l = { e.data(), e.size(), v.size() };
+    std::vector<int> d(n + 1, 0x5a5a5a5a);
+    varint_decode(&l, d.data());
+    ASSERT_TRUE(std::equal(v.begin(), v.end(), d.begin())) << "trial " << t;
+    ASSERT_EQ(0x5a5a5a5a, d[n]);
+  }
+
+  std::vector<int> ext = { INT_MIN, INT_MIN, -1, 0, INT_MAX, INT_MAX };
+  std::vector<unsigned char> e = encode(ext);
+  ASSERT_EQ(1 + 1 + 5 + 1 + 5 + 1u, e.size());
+  varint_list l = { e.data(), e.size(), ext.size() };
+  std::vector<int> d(ext.size());
+  varint_decode(&l, d.data());
+  ASSERT_EQ(ext, d);
+}
+
+// The merged output must be byte for byte the encoding of the merged values.
+TEST(VarintMergeTest, Merge)
+{
+  std::mt19937 gen(9);
+  static const uint32_t gaps[] = { 3, 127, 300, 1u << 24 };
+
+  for (unsigned k = 0; k <= 6; ++k) {
+    for (int t = 0; t < 12; ++t) {
+      std::vector<std::vector<int>> lists(k);
+      std::vector<std::vector<unsigned char>> enc(k);
+      std::vector<varint_list> in(k);
+      std::vector<int> all;
+      for (unsigned i = 0; i < k; ++i) {
+        size_t n = std::uniform_int_distribution<size_t>(0, t < 6 ? 50 : 3000)(gen);
+        lists[i] = random_gaps(gen, n, -5000 * (int) i, gaps[(t + i) % 4]);
+        enc[i] = encode(lists[i]);
+        in[i] = { enc[i].data(), enc[i].size(), lists[i].size() };
+        all.insert(all.end(), lists[i].begin(), lists[i].end());
+      }
+      std::sort(all.begin(), all.end());
+      std::vector<unsigned char> want = encode(all);
+
+      std::vector<unsigned char> out(VARINT_MAX_BYTES(all.size()) + 1, 0x5a);
+      size_t bytes = sorted_merge_varint(in.data(), k, out.data());
+      ASSERT_EQ(want.size(), bytes) << "k = " << k << ", trial " << t;
+      ASSERT_TRUE(std::equal(want.begin(), want.end(), out.begin()))
+          << "k = " << k << ", trial " << t;
+      ASSERT_EQ(0x5a, out[bytes]);
+    }
+  }
+}
@@ -1,6 +1,145 @@
-#include <iostream>
+#include <benchmark/benchmark.h>
+#include "sort_char.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
 
-int main() {
-    std::cout << "Benchmark sort char placeholder." << std::endl;
-    return 0;
+// Input distributions, selected by range(1).
+enum byte_dist {
+    DIST_UNIFORM,   // uniform over 1..255
+    DIST_SORTED,
+    DIST_REVERSE,
+    DIST_FEW,       // 4 distinct values
+    DIST_EQUAL,
+    DIST_TEXT       // English text
+};
+
+static const char sample_text[] =
+    "It was the best of times, it was the worst of times, it was the age of "
+    "wisdom, it was the age of foolishness, it was the epoch of belief, it "
+    "was the epoch of incredulity, it was the season of Light, it was the "
+    "season of Darkness, it was the spring of hope, it was the winter of "
+    "despair, we had everything before us, we had nothing before us.\n";
+
+static const char* dist_names[] = {
+    "uniform", "sorted", "reverse", "few", "equal", "text"
+};
+
+// Fills n bytes plus a terminating NUL. No value is 0, so sort_char sees
+// the whole buffer.
+static std::vector<char> make_input(size_t n, int dist) {
+    std::vector<char> v(n + 1);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> byte(1, 255);
+    switch (dist) {
+    case DIST_UNIFORM:
+    case DIST_SORTED:
+    case DIST_REVERSE:
+        for (size_t i = 0; i < n; i++)
+            v[i] = (char) byte(gen);
+        break;
+    case DIST_FEW:
+        for (size_t i = 0; i < n; i++)
+            v[i] = "ACGT"[gen() % 4];
+        break;
+    case DIST_EQUAL:
+        memset(v.data(), 'e', n);
+        break;
+    case DIST_TEXT:
+        for (size_t i = 0; i < n; ) {
+            size_t len = sizeof(sample_text) - 1, off = gen() % len;
+            size_t m = std::min(len - off, n - i);
+            memcpy(&v[i], sample_text + off, m);
+            i += m;
+        }
+        break;
+    }
+    if (dist == DIST_SORTED)
+        std::sort(v.begin(), v.begin() + n);
+    if (dist == DIST_REVERSE)
+        std::sort(v.begin(), v.begin() + n, std::greater<char>());
+    v[n] = '\0';
+    return v;
+}
+
+// Each iteration restores the unsorted input with memcpy before sorting, for
+// every variant alike, so the copy is part of all the timings.
+template <typename Sort>
+static void run_sort(benchmark::State& state, Sort sort) {
+    size_t n = state.range(0);
+    std::vector<char> in = make_input(n, state.range(1)), v(in);
+    for (auto _ : state) {
+        memcpy(v.data(), in.data(), n + 1);
+        sort(v.data(), n);
+        benchmark::DoNotOptimize(v.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t) n);
+    state.SetLabel(dist_names[state.range(1)]);
+}
+
+static void BM_sort_char(benchmark::State& state) {
+    run_sort(state, [](char* v, size_t) { sort_char(v); });
+}
+
+static void BM_sort_chars(benchmark::State& state) {
+    run_sort(state, [](char* v, size_t n) { sort_chars(v, n); });
+}
+
+static void BM_sort_bytes(benchmark::State& state) {
+    run_sort(state, [](char* v, size_t n) {
+        sort_bytes((unsigned char*) v, n);
+    });
 }
+
+static void BM_std_sort(benchmark::State& state) {
+    run_sort(state, [](char* v, size_t n) { std::sort(v, v + n); });
+}
+
+static void sort_args(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"n", "dist"});
+    b->ArgsProduct({{0, 64, 4 << 10, 1 << 20, 16 << 20},
+                    {DIST_UNIFORM, DIST_SORTED, DIST_REVERSE, DIST_FEW,
+                     DIST_EQUAL, DIST_TEXT}});
+    b->Unit(benchmark::kMicrosecond);
+}
+
+// sort_bytes with the counting kernel forced to range(2).
+static void BM_sort_bytes_kernel(benchmark::State& state) {
+    if (!sort_char_set_kernel((sort_char_kernel) state.range(2))) {
+        state.SkipWithError("kernel not supported");
+        return;
+    }
+    BM_sort_bytes(state);
+    sort_char_set_kernel(SORT_CHAR_KERNEL_AUTO);
+}
+
+// sort_bytes_parallel on range(2) threads, 0 for the hardware concurrency.
+static void BM_sort_bytes_parallel(benchmark::State& state) {
+    unsigned nthreads = state.range(2);
+    run_sort(state, [nthreads](char* v, size_t n) {
+        sort_bytes_parallel((unsigned char*) v, n, nthreads);
+    });
+}
+
+BENCHMARK(BM_sort_char)->Apply(sort_args);
+BENCHMARK(BM_sort_chars)->Apply(sort_args);
+BENCHMARK(BM_sort_bytes)->Apply(sort_args);
+BENCHMARK(BM_std_sort)->Apply(sort_args);
+BENCHMARK(BM_sort_bytes_kernel)
+    ->ArgNames({"n", "dist", "kernel"})
+    ->ArgsProduct({{64 << 10, 16 << 20},
+                   {DIST_UNIFORM, DIST_SORTED, DIST_FEW, DIST_EQUAL, DIST_TEXT},
+                   {SORT_CHAR_KERNEL_SINGLE, SORT_CHAR_KERNEL_MULTI,
+                    SORT_CHAR_KERNEL_SSE2, SORT_CHAR_KERNEL_AVX2}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_sort_bytes_parallel)
+    ->ArgNames({"n", "dist", "threads"})
+    ->ArgsProduct({{64 << 20, 256 << 20, 1 << 30}, {DIST_UNIFORM, DIST_TEXT},
+                   {1, 2, 4, 8, 0}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -1,23 +1,168 @@
 #include "sort_char.h"
-#include <cstddef>
+#include "sort_char_kernels.h"
+#include <atomic>
+#include <climits>
+#include <cstring>
 
-void sort_char(char* v) {
-    if (!v) return;
-    
-    size_t length = 0;
-    while (v[length] != '\0') {
-        length++;
+// Counting sort: a histogram of the byte values, then each value written
+// back as one run. O(n + 256).
+
+// Below this size the 8 tables of the multi-histogram kernels cost more to
+// clear and add up than they save.
+#define SORT_MULTI_MIN 1024
+
+void count_single(const unsigned char* v, size_t n, size_t* count) {
+    for (size_t i = 0; i < n; i++)
+        count[v[i]]++;
+}
+
+static void count_block_multi(const unsigned char* v, size_t n,
+                              hist_tables h) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, v + i, 8);
+        // 8 equal bytes go to one counter at once
+        if (w == (w & 0xff) * 0x0101010101010101ull)
+            h[0][w & 0xff] += 8;
+        else
+            count_word(h, w);
     }
-    
-    if (length <= 1) return;
-    
-    for (size_t i = 0; i < length - 1; i++) {
-        for (size_t j = 0; j < length - 1 - i; j++) {
-            if (v[j] > v[j + 1]) {
-                char temp = v[j];
-                v[j] = v[j + 1];
-                v[j + 1] = temp;
-            }
+    for (; i < n; i++)
+        h[0][v[i]]++;
+}
+
+void count_multi(const unsigned char* v, size_t n, size_t* count) {
+    count_blocks(v, n, count, count_block_multi);
+}
+
+unsigned char* fill_memset(unsigned char* out, unsigned char*,
+                           const size_t* count, int first, int last) {
+    for (int c = first; c <= last; c++) {
+        if (count[c]) {
+            memset(out, c, count[c]);
+            out += count[c];
         }
     }
+    return out;
+}
+
+static void resolve_count(const unsigned char* v, size_t n, size_t* count);
+static unsigned char* resolve_fill(unsigned char* out, unsigned char* end,
+                                   const size_t* count, int first, int last);
+
+static std::atomic<count_fn> count_impl(resolve_count);
+static std::atomic<fill_fn> fill_impl(resolve_fill);
+static std::atomic<sort_char_kernel> kernel_in_use(SORT_CHAR_KERNEL_AUTO);
+
+static bool kernel_supported(sort_char_kernel k) {
+    switch (k) {
+    case SORT_CHAR_KERNEL_AUTO:
+    case SORT_CHAR_KERNEL_SINGLE:
+    case SORT_CHAR_KERNEL_MULTI:
+        return true;
+#ifdef SORT_CHAR_HAVE_X86_SIMD
+    case SORT_CHAR_KERNEL_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case SORT_CHAR_KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+bool sort_char_set_kernel(sort_char_kernel k) {
+    count_fn count = count_multi;
+    fill_fn fill = fill_memset;
+
+    if (!kernel_supported(k))
+        return false;
+    if (k == SORT_CHAR_KERNEL_AUTO) {
+        k = SORT_CHAR_KERNEL_MULTI;
+        if (kernel_supported(SORT_CHAR_KERNEL_SSE2))
+            k = SORT_CHAR_KERNEL_SSE2;
+        if (kernel_supported(SORT_CHAR_KERNEL_AVX2))
+            k = SORT_CHAR_KERNEL_AVX2;
+    }
+    switch (k) {
+    case SORT_CHAR_KERNEL_SINGLE:
+        count = count_single;
+        break;
+#ifdef SORT_CHAR_HAVE_X86_SIMD
+    case SORT_CHAR_KERNEL_SSE2:
+        count = count_sse2;
+        fill = fill_sse2;
+        break;
+    case SORT_CHAR_KERNEL_AVX2:
+        count = count_avx2;
+        fill = fill_avx2;
+        break;
+#endif
+    default:
+        break;
+    }
+    count_impl.store(count, std::memory_order_relaxed);
+    fill_impl.store(fill, std::memory_order_relaxed);
+    kernel_in_use.store(k, std::memory_order_relaxed);
+    return true;
+}
+
+sort_char_kernel sort_char_get_kernel() {
+    if (kernel_in_use.load(std::memory_order_relaxed) == SORT_CHAR_KERNEL_AUTO)
+        sort_char_set_kernel(SORT_CHAR_KERNEL_AUTO);
+    return kernel_in_use.load(std::memory_order_relaxed);
+}
+
+static void resolve_count(const unsigned char* v, size_t n, size_t* count) {
+    sort_char_set_kernel(SORT_CHAR_KERNEL_AUTO);
+    count_impl.load(std::memory_order_relaxed)(v, n, count);
+}
+
+static unsigned char* resolve_fill(unsigned char* out, unsigned char* end,
+                                   const size_t* count, int first, int last) {
+    sort_char_set_kernel(SORT_CHAR_KERNEL_AUTO);
+    return fill_impl.load(std::memory_order_relaxed)(out, end, count, first,
+                                                     last);
+}
+
+void count_bytes(const unsigned char* v, size_t n, size_t* count) {
+    memset(count, 0, 256 * sizeof(size_t));
+    if (n < SORT_MULTI_MIN)
+        count_single(v, n, count);
+    else
+        count_impl.load(std::memory_order_relaxed)(v, n, count);
+}
+
+unsigned char* fill_bytes(unsigned char* out, unsigned char* end,
+                          const size_t* count, int first, int last) {
+    return fill_impl.load(std::memory_order_relaxed)(out, end, count, first,
+                                                     last);
+}
+
+void sort_bytes(unsigned char* v, size_t n) {
+    if (!v || n <= 1) return;
+
+    size_t count[256];
+    count_bytes(v, n, count);
+    fill_bytes(v, v + n, count, 0x00, 0xff);
+}
+
+void sort_chars(char* v, size_t n) {
+    if (!v || n <= 1) return;
+
+    unsigned char* p = (unsigned char*) v;
+    size_t count[256];
+    count_bytes(p, n, count);
+    // the negative values first
+    fill_bytes(fill_bytes(p, p + n, count, 0x80, 0xff), p + n, count, 0x00,
+               0x7f);
+}
+
+void sort_char(char* v) {
+    if (!v) return;
+    if (CHAR_MIN < 0)
+        sort_chars(v, strlen(v));
+    else
+        sort_bytes((unsigned char*) v, strlen(v));
 }
@@ -1,6 +1,46 @@
 #ifndef SORT_CHAR_H
 #define SORT_CHAR_H
 
+#include <cstddef>
+
+// Sorts the n bytes of v as unsigned values 0x00-0xff. NUL bytes are
+// sorted like any other; no terminator is needed.
+void sort_bytes(unsigned char* v, size_t n);
+
+// Sorts the n bytes of v as signed char values, so 0x80-0xff come before
+// 0x00-0x7f whatever the signedness of plain char.
+void sort_chars(char* v, size_t n);
+
+// Multithreaded sort_bytes and sort_chars for buffers of several MB. Each
+// thread counts its own slice of v; the histograms are added up into the
+// offset of every value, and each thread then writes its own equal share of
+// the output. Buffers with less than 1 MB per thread use fewer threads, down
+// to the calling thread alone. nthreads counts the caller; 0 uses the
+// hardware concurrency.
+void sort_bytes_parallel(unsigned char* v, size_t n, unsigned nthreads);
+void sort_chars_parallel(char* v, size_t n, unsigned nthreads);
+
+// Sorts the NUL-terminated string v in place in plain char order: that of
+// sort_chars where char is signed (x86) and of sort_bytes where it is
+// unsigned (ARM, PowerPC).
 void sort_char(char* v);
 
+// Counting kernels behind the sorts. SORT_CHAR_KERNEL_AUTO picks the fastest
+// one the CPU supports, checked once through CPUID; the others force one,
+// mainly for benchmarking and testing. All give identical results.
+enum sort_char_kernel {
+    SORT_CHAR_KERNEL_AUTO,
+    SORT_CHAR_KERNEL_SINGLE,  // one histogram, memset fills
+    SORT_CHAR_KERNEL_MULTI,   // 8 interleaved histograms, 64-bit loads
+    SORT_CHAR_KERNEL_SSE2,    // 16-byte loads and fills
+    SORT_CHAR_KERNEL_AVX2     // 32-byte loads and fills
+};
+
+// Selects the kernel used from now on by every thread. Returns false, and
+// keeps the previous selection, if the CPU or build lacks it.
+bool sort_char_set_kernel(sort_char_kernel k);
+
+// Returns the kernel in use, never SORT_CHAR_KERNEL_AUTO.
+sort_char_kernel sort_char_get_kernel();
+
 #endif
@@ -0,0 +1,85 @@
+#ifndef SORT_CHAR_KERNELS_H
+#define SORT_CHAR_KERNELS_H
+
+// Internal: counting and fill kernels behind sort_bytes and sort_chars.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Adds the byte values of v[0, n) to count.
+typedef void (*count_fn)(const unsigned char* v, size_t n, size_t* count);
+
+// Writes count[c] copies of c for c = first..last from out on, returning the
+// end of what it wrote. Bytes from there up to end may be overwritten too;
+// the runs that follow cover them.
+typedef unsigned char* (*fill_fn)(unsigned char* out, unsigned char* end,
+                                  const size_t* count, int first, int last);
+
+void count_single(const unsigned char* v, size_t n, size_t* count);
+void count_multi(const unsigned char* v, size_t n, size_t* count);
+unsigned char* fill_memset(unsigned char* out, unsigned char* end,
+                           const size_t* count, int first, int last);
+
+// Zeroes count and adds the byte values of v[0, n) with the kernel in use.
+void count_bytes(const unsigned char* v, size_t n, size_t* count);
+
+// fill_fn of the kernel in use.
+unsigned char* fill_bytes(unsigned char* out, unsigned char* end,
+                          const size_t* count, int first, int last);
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SORT_CHAR_HAVE_X86_SIMD 1
+void count_sse2(const unsigned char* v, size_t n, size_t* count);
+void count_avx2(const unsigned char* v, size_t n, size_t* count);
+unsigned char* fill_sse2(unsigned char* out, unsigned char* end,
+                         const size_t* count, int first, int last);
+unsigned char* fill_avx2(unsigned char* out, unsigned char* end,
+                         const size_t* count, int first, int last);
+#endif
+
+// The multi-histogram kernels spread consecutive bytes over SORT_HISTS
+// tables, so a run of one value increments SORT_HISTS different counters
+// in turn instead of waiting on the store of the previous increment. The
+// tables hold 32-bit counts and are added into count every
+// SORT_COUNT_BLOCK bytes, before they can overflow.
+#define SORT_HISTS 8
+#define SORT_COUNT_BLOCK ((size_t) 1 << 30)
+
+typedef uint32_t hist_tables[SORT_HISTS][256];
+
+// Counts the 8 bytes of w, one per table.
+static inline void count_word(hist_tables h, uint64_t w) {
+    h[0][w & 0xff]++;
+    h[1][(w >> 8) & 0xff]++;
+    h[2][(w >> 16) & 0xff]++;
+    h[3][(w >> 24) & 0xff]++;
+    h[4][(w >> 32) & 0xff]++;
+    h[5][(w >> 40) & 0xff]++;
+    h[6][(w >> 48) & 0xff]++;
+    h[7][w >> 56]++;
+}
+
+// Runs block(v, m, h) on blocks of at most SORT_COUNT_BLOCK bytes and adds
+// the tables into count.
+static inline void count_blocks(const unsigned char* v, size_t n,
+                                size_t* count,
+                                void (*block)(const unsigned char*, size_t,
+                                              hist_tables)) {
+    hist_tables h;
+    while (n) {
+        size_t m = n < SORT_COUNT_BLOCK ? n : SORT_COUNT_BLOCK;
+        memset(h, 0, sizeof(h));
+        block(v, m, h);
+        for (int c = 0; c < 256; c++) {
+            size_t sum = 0;
+            for (int t = 0; t < SORT_HISTS; t++)
+                sum += h[t][c];
+            count[c] += sum;
+        }
+        v += m;
+        n -= m;
+    }
+}
+
+#endif
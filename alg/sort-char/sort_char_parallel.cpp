@@ -0,0 +1,106 @@
+#include "sort_char.h"
+#include "sort_char_kernels.h"
+#include <cstdlib>
+#include <thread>
+
+#define PAR_MAX_THREADS 256
+#define PAR_MIN_PER_THREAD (1 << 20)
+
+struct par_sort {
+    unsigned char* v;
+    size_t n;
+    unsigned nthreads;
+    bool is_signed;
+    size_t (*count)[256];  // per thread, then added up in count[0]
+    size_t start[256];     // output offset of each value
+};
+
+static size_t slice_start(size_t n, unsigned t, unsigned nthreads) {
+    return n / nthreads * t + n % nthreads * t / nthreads;
+}
+
+static void count_slice(par_sort* ps, unsigned t) {
+    size_t lo = slice_start(ps->n, t, ps->nthreads);
+    size_t hi = slice_start(ps->n, t + 1, ps->nthreads);
+    count_bytes(ps->v + lo, hi - lo, ps->count[t]);
+}
+
+// Writes output bytes [lo, hi): the run of each value clipped to the range.
+static void fill_slice(par_sort* ps, unsigned t) {
+    size_t lo = slice_start(ps->n, t, ps->nthreads);
+    size_t hi = slice_start(ps->n, t + 1, ps->nthreads);
+    size_t clip[256];
+
+    for (int c = 0; c < 256; c++) {
+        size_t s = ps->start[c], e = s + ps->count[0][c];
+        s = s > lo ? s : lo;
+        e = e < hi ? e : hi;
+        clip[c] = s < e ? e - s : 0;
+    }
+    unsigned char* out = ps->v + lo;
+    unsigned char* end = ps->v + hi;
+    if (ps->is_signed)
+        fill_bytes(fill_bytes(out, end, clip, 0x80, 0xff), end, clip, 0x00,
+                   0x7f);
+    else
+        fill_bytes(out, end, clip, 0x00, 0xff);
+}
+
+// runs fn for t = 1..nthreads-1 on new threads and t = 0 on the caller
+static void run_workers(par_sort* ps, void (*fn)(par_sort*, unsigned)) {
+    std::thread workers[PAR_MAX_THREADS];
+
+    for (unsigned t = 1; t < ps->nthreads; t++)
+        workers[t] = std::thread(fn, ps, t);
+    fn(ps, 0);
+    for (unsigned t = 1; t < ps->nthreads; t++)
+        workers[t].join();
+}
+
+// Returns false if it would run on one thread or is out of memory; the
+// caller then sorts serially.
+static bool sort_parallel(unsigned char* v, size_t n, unsigned nthreads,
+                          bool is_signed) {
+    if (!nthreads)
+        nthreads = std::thread::hardware_concurrency();
+    if (nthreads > n / PAR_MIN_PER_THREAD)
+        nthreads = n / PAR_MIN_PER_THREAD;
+    if (nthreads > PAR_MAX_THREADS)
+        nthreads = PAR_MAX_THREADS;
+    if (nthreads <= 1)
+        return false;
+
+    par_sort ps;
+    ps.v = v;
+    ps.n = n;
+    ps.nthreads = nthreads;
+    ps.is_signed = is_signed;
+    ps.count = (size_t (*)[256]) malloc(nthreads * sizeof(*ps.count));
+    if (!ps.count)
+        return false;
+
+    run_workers(&ps, count_slice);
+    for (unsigned t = 1; t < nthreads; t++)
+        for (int c = 0; c < 256; c++)
+            ps.count[0][c] += ps.count[t][c];
+    size_t pos = 0;
+    for (int i = 0; i < 256; i++) {
+        // signed order starts at 0x80
+        int c = is_signed ? (i + 0x80) & 0xff : i;
+        ps.start[c] = pos;
+        pos += ps.count[0][c];
+    }
+    run_workers(&ps, fill_slice);
+    free(ps.count);
+    return true;
+}
+
+void sort_bytes_parallel(unsigned char* v, size_t n, unsigned nthreads) {
+    if (!v || !sort_parallel(v, n, nthreads, false))
+        sort_bytes(v, n);
+}
+
+void sort_chars_parallel(char* v, size_t n, unsigned nthreads) {
+    if (!v || !sort_parallel((unsigned char*) v, n, nthreads, true))
+        sort_chars(v, n);
+}
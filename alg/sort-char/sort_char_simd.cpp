@@ -0,0 +1,113 @@
+#include "sort_char_kernels.h"
+
+#ifdef SORT_CHAR_HAVE_X86_SIMD
+#include <immintrin.h>
+
+// Vector counting and fill kernels for x86, compiled for their instruction
+// set through target attributes and called only after a CPUID check.
+//
+// Counting loads 16 or 32 bytes at a time. A block whose bytes all equal its
+// first byte, the common case in runs, adds its width to one counter at
+// once; any other block is counted 8 bytes per table word as in count_multi.
+// Filling stores whole registers of the broadcast byte; the last store of a
+// run may reach into the next runs, which overwrite it, and only the last
+// register's worth of the buffer needs an overlapping store.
+#define SSE2 __attribute__((target("sse2")))
+#define AVX2 __attribute__((target("avx2")))
+
+// Scalar loads of the block again: they hit L1 and are cheaper than moving
+// each 64-bit lane out of the vector register.
+static inline void count_words(hist_tables h, const unsigned char* v,
+                               int words) {
+    for (int j = 0; j < words; j++) {
+        uint64_t w;
+        memcpy(&w, v + 8 * j, 8);
+        count_word(h, w);
+    }
+}
+
+static SSE2 void count_block_sse2(const unsigned char* v, size_t n,
+                                  hist_tables h) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*) (v + i));
+        __m128i first = _mm_set1_epi8((char) v[i]);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, first)) == 0xffff) {
+            h[0][v[i]] += 16;
+            continue;
+        }
+        count_words(h, v + i, 2);
+    }
+    for (; i < n; i++)
+        h[0][v[i]]++;
+}
+
+static AVX2 void count_block_avx2(const unsigned char* v, size_t n,
+                                  hist_tables h) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*) (v + i));
+        __m256i first = _mm256_set1_epi8((char) v[i]);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, first)) == -1) {
+            h[0][v[i]] += 32;
+            continue;
+        }
+        count_words(h, v + i, 4);
+    }
+    for (; i < n; i++)
+        h[0][v[i]]++;
+}
+
+void count_sse2(const unsigned char* v, size_t n, size_t* count) {
+    count_blocks(v, n, count, count_block_sse2);
+}
+
+void count_avx2(const unsigned char* v, size_t n, size_t* count) {
+    count_blocks(v, n, count, count_block_avx2);
+}
+
+SSE2 unsigned char* fill_sse2(unsigned char* out, unsigned char* end,
+                              const size_t* count, int first, int last) {
+    for (int c = first; c <= last; c++) {
+        size_t n = count[c];
+        if (!n)
+            continue;
+        unsigned char* stop = out + n;
+        if (end - out < 16) {
+            memset(out, c, n);
+            out = stop;
+            continue;
+        }
+        __m128i b = _mm_set1_epi8((char) c);
+        for (; out + 16 <= stop; out += 16)
+            _mm_storeu_si128((__m128i*) out, b);
+        if (out < stop)
+            _mm_storeu_si128((__m128i*) (end - out >= 16 ? out : stop - 16), b);
+        out = stop;
+    }
+    return out;
+}
+
+AVX2 unsigned char* fill_avx2(unsigned char* out, unsigned char* end,
+                              const size_t* count, int first, int last) {
+    for (int c = first; c <= last; c++) {
+        size_t n = count[c];
+        if (!n)
+            continue;
+        unsigned char* stop = out + n;
+        if (end - out < 32) {
+            memset(out, c, n);
+            out = stop;
+            continue;
+        }
+        __m256i b = _mm256_set1_epi8((char) c);
+        for (; out + 32 <= stop; out += 32)
+            _mm256_storeu_si256((__m256i*) out, b);
+        if (out < stop)
+            _mm256_storeu_si256((__m256i*) (end - out >= 32 ? out : stop - 32),
+                                b);
+        out = stop;
+    }
+    return out;
+}
+#endif
@@ -1,6 +1,10 @@
 #include "sort_char.h"
 #include <iostream>
 #include <cstring>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
 
 bool test_basic_sorting() {
     char test[] = "hello";
@@ -44,6 +48,117 @@ bool test_mixed_case() {
     return strcmp(test, "BCa") == 0;
 }
 
+static bool signed_less(char a, char b) {
+    return (signed char) a < (signed char) b;
+}
+
+bool test_high_bytes() {
+    char test[] = "b\xe9" "a\x80";
+    std::string expected = test;
+    std::sort(expected.begin(), expected.end());
+    sort_char(test);
+    return expected == test;
+}
+
+bool test_large_buffer() {
+    std::vector<char> test(1 << 20);
+    std::mt19937 gen(1);
+    for (char& c : test)
+        c = (char) (gen() % 255 + 1);
+    test.back() = '\0';
+    std::vector<char> expected(test);
+    std::sort(expected.begin(), expected.end() - 1);
+    sort_char(test.data());
+    return test == expected;
+}
+
+bool test_bytes_with_nul() {
+    unsigned char test[] = { 'b', 0, 0xff, 'a', 0x80, 0 };
+    unsigned char expected[] = { 0, 0, 'a', 'b', 0x80, 0xff };
+    sort_bytes(test, sizeof(test));
+    return memcmp(test, expected, sizeof(test)) == 0;
+}
+
+bool test_chars_signed_order() {
+    char test[] = { 'b', 0, (char) 0xff, 'a', (char) 0x80, 0 };
+    char expected[] = { (char) 0x80, (char) 0xff, 0, 0, 'a', 'b' };
+    sort_chars(test, sizeof(test));
+    return memcmp(test, expected, sizeof(test)) == 0;
+}
+
+bool test_length_prefix() {
+    char test[] = "dcba";
+    sort_chars(test, 2);
+    sort_bytes(nullptr, 5);
+    return strcmp(test, "cdba") == 0;
+}
+
+// Every supported kernel against std::sort, over sizes around the vector
+// widths and the multi-histogram cutoff, unaligned starts, and inputs from
+// random bytes to long runs.
+bool test_all_kernels() {
+    const size_t sizes[] = { 2, 15, 16, 17, 31, 33, 100, 1023, 1024, 5000,
+                             100003 };
+    std::mt19937 gen(7);
+    bool ok = true;
+    for (int k = SORT_CHAR_KERNEL_SINGLE; k <= SORT_CHAR_KERNEL_AVX2; k++) {
+        if (!sort_char_set_kernel((sort_char_kernel) k))
+            continue;
+        ok &= sort_char_get_kernel() == k;
+        for (size_t n : sizes) {
+            for (int run = 1; run <= 4096; run *= 8) {
+                std::vector<unsigned char> buf(n + 3);
+                for (size_t i = 0; i < buf.size(); i += run)
+                    memset(&buf[i], (int) (gen() % 256),
+                           std::min<size_t>(run, buf.size() - i));
+                unsigned char* v = &buf[n % 4];
+                std::vector<unsigned char> in(v, v + n), want(in);
+                std::sort(want.begin(), want.end());
+                sort_bytes(v, n);
+                ok &= std::equal(want.begin(), want.end(), v);
+
+                std::vector<char> cwant(in.begin(), in.end());
+                std::sort(cwant.begin(), cwant.end(), signed_less);
+                memcpy(v, in.data(), n);
+                sort_chars((char*) v, n);
+                ok &= memcmp(cwant.data(), v, n) == 0;
+            }
+        }
+    }
+    sort_char_set_kernel(SORT_CHAR_KERNEL_AUTO);
+    return ok;
+}
+
+// Several MB so that up to 5 threads get a slice; runs of random length make
+// the runs of the output cross the thread boundaries at odd offsets. Values
+// span all 256 bytes, so signed and unsigned order differ.
+bool test_parallel() {
+    const size_t n = (5 << 20) + 123;
+    std::vector<unsigned char> in(n);
+    std::mt19937 gen(11);
+    for (size_t i = 0; i < n; ) {
+        size_t run = std::min<size_t>(gen() % 300 + 1, n - i);
+        memset(&in[i], (int) (gen() % 256), run);
+        i += run;
+    }
+    std::vector<unsigned char> want(in), v;
+    sort_bytes(want.data(), n);
+    std::vector<char> cwant(in.begin(), in.end());
+    sort_chars(cwant.data(), n);
+
+    bool ok = true;
+    for (unsigned nthreads : { 0u, 1u, 2u, 3u, 5u, 64u }) {
+        v = in;
+        sort_bytes_parallel(v.data(), n, nthreads);
+        ok &= v == want;
+        v = in;
+        sort_chars_parallel((char*) v.data(), n, nthreads);
+        ok &= memcmp(v.data(), cwant.data(), n) == 0;
+    }
+    sort_bytes_parallel(nullptr, 0, 4);
+    return ok;
+}
+
 bool test_null_pointer() {
     sort_char(nullptr);
     return true;
@@ -61,13 +176,20 @@ int main() {
         {"Reverse sorted", test_reverse_sorted},
         {"Duplicates", test_duplicates},
         {"Mixed case", test_mixed_case},
+        {"High bytes", test_high_bytes},
+        {"1 MB buffer", test_large_buffer},
+        {"Bytes with NUL", test_bytes_with_nul},
+        {"Signed char order", test_chars_signed_order},
+        {"Explicit length", test_length_prefix},
+        {"All kernels", test_all_kernels},
+        {"Parallel", test_parallel},
         {"Null pointer", test_null_pointer}
     };
     
     int passed = 0;
     int total = sizeof(tests) / sizeof(tests[0]);
     
-    std::cout << "=== Character Sort Tests (Bubble Sort) ===" << std::endl;
+    std::cout << "=== Character Sort Tests (Counting Sort) ===" << std::endl;
     
     for (int i = 0; i < total; i++) {
         std::cout << "Running: " << tests[i].name << "... ";